@@ -6,3 +6,4 @@
 #include "Layer.h"
 #include "Notification.h"
 #include "Display.h"
+#include "DisplayGroup.h"
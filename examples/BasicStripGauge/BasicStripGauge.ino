@@ -9,6 +9,7 @@ CRGB leds[NUM_LEDS];
 LedLayer::LinearLayout layout(NUM_LEDS);
 LedLayer::FastLEDRenderer<NEOPIXEL, LED_PIN, GRB> renderer(leds, NUM_LEDS);
 LedLayer::Display<3> display(renderer, layout);
+static_assert(LedLayer::DisplayFootprint<3>::total <= 1024, "gauge display exceeds its SRAM budget");
 
 float sensorValue = 0.5f;
 
@@ -11,9 +11,7 @@ LedLayer::FastLEDRenderer<NEOPIXEL, LED_PIN, GRB> renderer(leds, NUM_LEDS);
 LedLayer::Display<5> display(renderer, layout);
 
 float statusValue = 0.5f;
-float hour = 10.0f;
-float minute = 15.0f;
-float second = 30.0f;
+float clockHours = 0.0f;   // hours since 12 o'clock
 
 void setup() {
     renderer.begin();
@@ -23,34 +21,24 @@ void setup() {
     statusLayer.mode = LedLayer::ModeType::MASK_FILL;
     display.addLayer(statusLayer);
 
-    LedLayer::LayerConfig hourHand;
-    hourHand.source = &hour;
-    hourHand.inMin = 0;
-    hourHand.inMax = 12;
-    hourHand.wrap = true;
-    hourHand.mode = LedLayer::ModeType::OVERLAY_MARKER_THICK;
-    hourHand.overlay.color = {255, 0, 0};
-    hourHand.overlay.thickness = 3;
-    display.addLayer(hourHand);
-
-    LedLayer::LayerConfig minuteHand;
-    minuteHand.source = &minute;
-    minuteHand.inMin = 0;
-    minuteHand.inMax = 60;
-    minuteHand.wrap = true;
-    minuteHand.mode = LedLayer::ModeType::OVERLAY_MARKER_THICK;
-    minuteHand.overlay.color = {0, 255, 0};
-    minuteHand.overlay.thickness = 2;
-    display.addLayer(minuteHand);
-
-    LedLayer::LayerConfig secondHand;
-    secondHand.source = &second;
-    secondHand.inMin = 0;
-    secondHand.inMax = 60;
-    secondHand.wrap = true;
-    secondHand.mode = LedLayer::ModeType::OVERLAY_MARKER_SINGLE;
-    secondHand.overlay.color = {0, 0, 255};
-    display.addLayer(secondHand);
+    // Hour marks are resolved to LEDs once in begin().
+    LedLayer::LayerConfig hourTicks;
+    hourTicks.source = &clockHours;
+    hourTicks.mode = LedLayer::ModeType::OVERLAY_CARDINAL_TICKS;
+    hourTicks.overlay.ticks = 4;
+    hourTicks.overlay.color = {40, 40, 40};
+    display.addLayer(hourTicks);
+
+    LedLayer::LayerConfig hands;
+    hands.source = &clockHours;
+    hands.inMin = 0;
+    hands.inMax = 12;
+    hands.wrap = true;
+    hands.mode = LedLayer::ModeType::OVERLAY_CLOCK_HANDS;
+    hands.overlay.color = {255, 0, 0};
+    hands.overlay.accent = {0, 0, 255};
+    hands.overlay.thickness = 3;
+    display.addLayer(hands);
 
     display.begin();
 }
@@ -61,10 +49,7 @@ void loop() {
     // This is a simplified clock for demonstration purposes.
     // In a real application, you would use a real-time clock (RTC)
     // to get the current time.
-    second = (millis() / 1000) % 60;
-    minute = (millis() / (1000 * 60)) % 60;
-    hour = (millis() / (1000 * 60 * 60)) % 12;
-
+    clockHours = ((millis() / 1000) % (12UL * 60 * 60)) / 3600.0f;
 
     display.tick(millis());
     delay(10);
@@ -0,0 +1,283 @@
+// Host-side benchmark for Display::tick().
+//
+//   ./pc_bench               run the matrix and print a table
+//   ./pc_bench --save FILE   also write the results as a baseline
+//   ./pc_bench --check FILE  compare against a baseline; exits non-zero if
+//                            any case is slower than --tolerance (0.15)
+//                            or allocates during tick()
+//
+// Each case reports the fastest of three timed runs.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <LedLayer.h>
+#include <PCRenderer.h>
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using namespace LedLayer;
+
+enum class Mix { GRADIENT, PALETTE_MASK, FULL };
+
+struct Case {
+    uint16_t leds;
+    bool ring;
+    Mix mix;
+    bool notification;
+};
+
+struct Result {
+    std::string name;
+    uint8_t layers;
+    double nsPerFrame;
+    double nsPerPixel;
+    double allocsPerFrame;
+};
+
+const char* mixName(Mix mix) {
+    switch (mix) {
+        case Mix::GRADIENT: return "gradient";
+        case Mix::PALETTE_MASK: return "palette+mask";
+        case Mix::FULL: return "full";
+    }
+    return "?";
+}
+
+std::string caseName(const Case& c) {
+    std::ostringstream out;
+    out << c.leds << (c.ring ? "/ring/" : "/linear/") << mixName(c.mix) << (c.notification ? "/notif" : "");
+    return out.str();
+}
+
+// Sources change every frame so no tick is skipped as unchanged.
+struct Inputs {
+    float value = 0.0f;
+    float state = 0.0f;
+    float hand = 0.0f;
+    float level = 1.0f;
+
+    void advance(uint32_t frame) {
+        value = (std::sin(frame * 0.05f) + 1.0f) / 2.0f;
+        state = float(frame / 7 % 3);
+        hand = float(frame % 240) / 240.0f;
+        level = 0.6f + 0.4f * value;
+    }
+};
+
+uint8_t addLayers(Display<8>& display, Mix mix, Inputs& in) {
+    uint8_t count = 0;
+    if (mix == Mix::PALETTE_MASK) {
+        LayerConfig palette;
+        palette.source = &in.state;
+        palette.inMax = 2.0f;
+        palette.mode = ModeType::COLOR_STATE_PALETTE;
+        palette.palette.count = 3;
+        palette.palette.colors[0] = {0, 255, 0};
+        palette.palette.colors[1] = {255, 160, 0};
+        palette.palette.colors[2] = {255, 0, 0};
+        count += display.addLayer(palette);
+    } else {
+        LayerConfig gradient;
+        gradient.source = &in.value;
+        gradient.mode = ModeType::COLOR_VALUE_GRADIENT;
+        gradient.gradient.from = {0, 255, 0};
+        gradient.gradient.to = {255, 0, 0};
+        count += display.addLayer(gradient);
+    }
+    if (mix == Mix::GRADIENT) return count;
+
+    LayerConfig mask;
+    mask.source = &in.value;
+    mask.mode = mix == Mix::FULL ? ModeType::MASK_WINDOW_POSITION : ModeType::MASK_FILL;
+    mask.mask.width = 0.6f;
+    count += display.addLayer(mask);
+    if (mix == Mix::PALETTE_MASK) return count;
+
+    LayerConfig bright;
+    bright.source = &in.level;
+    bright.mode = ModeType::BRIGHTNESS_GAMMA;
+    bright.brightness.gamma = 2.2f;
+    count += display.addLayer(bright);
+
+    LayerConfig limiter;
+    limiter.source = &in.level;
+    limiter.mode = ModeType::BRIGHTNESS_LIMITER;
+    count += display.addLayer(limiter);
+
+    LayerConfig chase;
+    chase.source = &in.value;
+    chase.mode = ModeType::MOTION_CHASE;
+    chase.motion.segmentPixels = 5;
+    count += display.addLayer(chase);
+
+    LayerConfig hand;
+    hand.source = &in.hand;
+    hand.mode = ModeType::OVERLAY_MARKER_THICK;
+    hand.overlay.pos = 0.25f;
+    hand.overlay.thickness = 3;
+    count += display.addLayer(hand);
+
+    LayerConfig marker;
+    marker.source = &in.hand;
+    marker.mode = ModeType::OVERLAY_MARKER_SINGLE;
+    marker.overlay.pos = 0.75f;
+    count += display.addLayer(marker);
+
+    LayerConfig hue;
+    hue.source = &in.value;
+    hue.mode = ModeType::COLOR_VALUE_HUE;
+    hue.priority = -1;
+    count += display.addLayer(hue);
+    return count;
+}
+
+Result run(const Case& c, uint32_t frames) {
+    PCRenderer renderer(c.leds);
+    LinearLayout linear(c.leds);
+    RingLayout ring(c.leds);
+    Layout& layout = c.ring ? static_cast<Layout&>(ring) : static_cast<Layout&>(linear);
+    Display<8> display(renderer, layout);
+    Inputs in;
+    Result result;
+    result.name = caseName(c);
+    result.layers = addLayers(display, c.mix, in);
+    display.begin();
+
+    Notification notif;
+    notif.type = NotifType::CHASE;
+    notif.mode = NotifMode::OVERLAY;
+    notif.color = {0, 0, 255};
+    notif.durationMs = 0xFFFFFFFFu;
+    notif.param = 8;
+    if (c.notification) display.notify(notif);
+
+    // Warm up caches and the gamma table outside the timed loop.
+    for (uint32_t f = 0; f < 16; ++f) {
+        in.advance(f);
+        display.tick(f * 16);
+    }
+
+    size_t allocsBefore = g_allocations;
+    double best = 0;
+    uint32_t t = 16;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t f = 0; f < frames; ++f, ++t) {
+            in.advance(t);
+            display.tick(t * 16);
+        }
+        auto stop = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        if (repeat == 0 || ns < best) best = ns;
+    }
+    size_t allocs = g_allocations - allocsBefore;
+
+    result.nsPerFrame = best / frames;
+    result.nsPerPixel = result.nsPerFrame / c.leds;
+    result.allocsPerFrame = double(allocs) / (3.0 * frames);
+    return result;
+}
+
+std::map<std::string, double> loadBaseline(const char* path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string name;
+    double ns;
+    while (in >> name >> ns) baseline[name] = ns;
+    return baseline;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const char* savePath = nullptr;
+    const char* checkPath = nullptr;
+    double tolerance = 0.15;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--save") && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (!strcmp(argv[i], "--check") && i + 1 < argc) {
+            checkPath = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--save FILE] [--check FILE] [--tolerance F]" << std::endl;
+            return 2;
+        }
+    }
+
+    const uint16_t sizes[] = {60, 144, 1000, 10000};
+    const Mix mixes[] = {Mix::GRADIENT, Mix::PALETTE_MASK, Mix::FULL};
+    std::vector<Result> results;
+
+    printf("%-32s %6s %12s %10s %8s\n", "case", "layers", "ns/frame", "ns/pixel", "allocs");
+    for (uint16_t leds : sizes) {
+        // Roughly the same pixel count per case keeps run time even.
+        uint32_t frames = 2000000u / leds;
+        if (frames < 200) frames = 200;
+        for (int ring = 0; ring < 2; ++ring) {
+            for (Mix mix : mixes) {
+                for (int notif = 0; notif < 2; ++notif) {
+                    Case c = {leds, ring != 0, mix, notif != 0};
+                    Result r = run(c, frames);
+                    printf("%-32s %6u %12.1f %10.3f %8.2f\n", r.name.c_str(), unsigned(r.layers),
+                           r.nsPerFrame, r.nsPerPixel, r.allocsPerFrame);
+                    results.push_back(r);
+                }
+            }
+        }
+    }
+
+    if (savePath) {
+        std::ofstream out(savePath);
+        for (const Result& r : results) out << r.name << " " << r.nsPerFrame << "\n";
+    }
+
+    int failures = 0;
+    if (checkPath) {
+        std::map<std::string, double> baseline = loadBaseline(checkPath);
+        for (const Result& r : results) {
+            if (r.allocsPerFrame > 0) {
+                printf("FAIL %s allocates %.2f times per frame\n", r.name.c_str(), r.allocsPerFrame);
+                ++failures;
+            }
+            auto it = baseline.find(r.name);
+            if (it == baseline.end()) continue;
+            double change = r.nsPerFrame / it->second - 1.0;
+            if (change > tolerance) {
+                printf("FAIL %s %.1f ns/frame vs %.1f baseline (%+.0f%%)\n", r.name.c_str(), r.nsPerFrame,
+                       it->second, change * 100.0);
+                ++failures;
+            }
+        }
+        printf("%d regression(s) against %s\n", failures, checkPath);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,338 @@
+// Host-side frame output check.
+//
+//   ./pc_frames               render the matrix and print a hash per case
+//   ./pc_frames --save FILE   also write the hashes as a baseline
+//   ./pc_frames --check FILE  compare against a baseline; exits non-zero if
+//                             any case renders different frames
+//
+// Every case is rendered three ways that must agree pixel for pixel: into
+// a frame buffer with partial redraws, invalidated before every frame so
+// each one is composed in full, and staged in chunks to a renderer that
+// only implements setPixel(). The hash then pins the output itself, so
+// optimizations that claim identical frames can be checked against it.
+// Build with LEDLAYER_NO_SIMD to run the scalar kernels instead of the
+// SSE2/NEON ones. The baseline holds float builds; LEDLAYER_FIXED_POINT
+// rounds differently.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <LedLayer.h>
+#include <PCRenderer.h>
+
+namespace {
+
+using namespace LedLayer;
+
+const uint32_t FRAMES = 400;
+
+enum class Shape { LINEAR, RING, RING_CCW, MATRIX };
+enum class Mix { GRADIENT, PALETTE_PULSE, HUE_GAMMA };
+enum class Path { BUFFER, FULL, STAGED };
+
+struct Case {
+    Shape shape;
+    uint16_t width;
+    uint16_t height;
+    Mix mix;
+};
+
+const char* shapeName(Shape shape) {
+    switch (shape) {
+        case Shape::LINEAR: return "linear";
+        case Shape::RING: return "ring";
+        case Shape::RING_CCW: return "ring-ccw";
+        case Shape::MATRIX: return "matrix";
+    }
+    return "?";
+}
+
+const char* mixName(Mix mix) {
+    switch (mix) {
+        case Mix::GRADIENT: return "gradient";
+        case Mix::PALETTE_PULSE: return "palette+pulse";
+        case Mix::HUE_GAMMA: return "hue+gamma";
+    }
+    return "?";
+}
+
+std::string caseName(const Case& c) {
+    std::ostringstream out;
+    out << c.width;
+    if (c.shape == Shape::MATRIX) out << "x" << c.height;
+    out << "/" << shapeName(c.shape) << "/" << mixName(c.mix);
+    return out.str();
+}
+
+// Renderer without a frame buffer, so the Display stages every frame.
+class PixelRenderer : public Renderer {
+public:
+    explicit PixelRenderer(uint16_t count) : _leds(count) {}
+
+    void begin() override {}
+    RGB getPixel(int index) const override { return _leds[index]; }
+    void setPixel(int index, const RGB& color) override { _leds[index] = color; }
+    void show() override {}
+
+    const std::vector<RGB>& leds() const { return _leds; }
+
+private:
+    std::vector<RGB> _leds;
+};
+
+// Triangle wave in [0, 1] over period frames. Only exact integer ratios
+// feed the layers, so every host sees the same inputs.
+float wave(uint32_t frame, uint32_t period) {
+    uint32_t t = frame % period;
+    uint32_t half = period / 2;
+    return float(t < half ? t : period - t) / float(half);
+}
+
+struct Inputs {
+    float color = 0.0f;
+    float level = 1.0f;
+    float fill = 0.0f;
+    float motion = 0.0f;
+    float hand = 0.0f;
+
+    void advance(uint32_t frame, Mix mix) {
+        color = wave(frame, 26);
+        if (mix == Mix::PALETTE_PULSE) color = float(frame / 9 % 3);
+        level = wave(frame, 14);
+        fill = wave(frame, 34);
+        motion = wave(frame, 46);
+        hand = float(frame % 90) / 90.0f;
+    }
+};
+
+void addLayers(Display<8>& display, Mix mix, Inputs& in) {
+    LayerConfig color;
+    color.source = &in.color;
+    if (mix == Mix::GRADIENT) {
+        color.mode = ModeType::COLOR_VALUE_GRADIENT;
+        color.gradient.from = {0, 255, 0};
+        color.gradient.to = {255, 0, 40};
+    } else if (mix == Mix::PALETTE_PULSE) {
+        color.mode = ModeType::COLOR_STATE_PALETTE;
+        color.inMax = 2.0f;
+        color.palette.count = 3;
+        color.palette.colors[0] = {255, 0, 0};
+        color.palette.colors[1] = {0, 255, 0};
+        color.palette.colors[2] = {0, 0, 255};
+    } else {
+        color.mode = ModeType::COLOR_VALUE_HUE;
+    }
+    display.addLayer(color);
+
+    LayerConfig bright;
+    bright.source = &in.level;
+    bright.mode = mix == Mix::HUE_GAMMA ? ModeType::BRIGHTNESS_GAMMA : ModeType::BRIGHTNESS_VALUE;
+    bright.brightness.gamma = 2.2f;
+    display.addLayer(bright);
+
+    LayerConfig mask;
+    mask.source = &in.fill;
+    mask.mode = mix == Mix::PALETTE_PULSE ? ModeType::MASK_CENTER_FILL : ModeType::MASK_FILL;
+    mask.mask.start = mix == Mix::HUE_GAMMA ? 0.7f : 0.1f;
+    display.addLayer(mask);
+
+    LayerConfig motion;
+    motion.source = &in.motion;
+    motion.mode = mix == Mix::PALETTE_PULSE ? ModeType::MOTION_PULSE : ModeType::MOTION_CHASE;
+    motion.motion.segmentPixels = 4;
+    motion.motion.color = {10, 20, 200};
+    display.addLayer(motion);
+
+    LayerConfig thick;
+    thick.source = &in.hand;
+    thick.mode = ModeType::OVERLAY_MARKER_THICK;
+    thick.overlay.pos = 0.3f;
+    thick.overlay.thickness = 3;
+    thick.overlay.color = {200, 200, 0};
+    display.addLayer(thick);
+
+    LayerConfig single;
+    single.source = &in.hand;
+    single.mode = ModeType::OVERLAY_MARKER_SINGLE;
+    single.overlay.pos = 0.75f;
+    single.overlay.color = {255, 255, 255};
+    display.addLayer(single);
+}
+
+void notifyAt(Display<8>& display, uint32_t frame) {
+    Notification notif;
+    switch (frame) {
+        case 50:
+            notif.type = NotifType::FLASH;
+            notif.mode = NotifMode::OVERLAY;
+            notif.color = {50, 0, 0};
+            notif.durationMs = 300;
+            break;
+        case 120:
+            notif.type = NotifType::PULSE;
+            notif.mode = NotifMode::OVERRIDE;
+            notif.color = {0, 90, 200};
+            notif.durationMs = 700;
+            break;
+        case 125:
+            notif.type = NotifType::CHASE;
+            notif.mode = NotifMode::OVERLAY;
+            notif.color = {0, 90, 200};
+            notif.durationMs = 900;
+            notif.param = 5;
+            break;
+        case 260:
+            notif.type = NotifType::PULSE;
+            notif.mode = NotifMode::OVERLAY;
+            notif.color = {100, 90, 20};
+            notif.durationMs = 900;
+            break;
+        default:
+            return;
+    }
+    display.notify(notif);
+}
+
+// Renders c along path and appends every frame to frames.
+void render(const Case& c, Path path, std::vector<RGB>& frames) {
+    const uint16_t count = c.width * c.height;
+    LinearLayout linear(count);
+    RingLayout ring(count, 3, true);
+    RingLayout ringCcw(count, 5, false);
+    MatrixLayout matrix(c.width, c.height);
+    Layout* layout = &linear;
+    if (c.shape == Shape::RING) layout = &ring;
+    if (c.shape == Shape::RING_CCW) layout = &ringCcw;
+    if (c.shape == Shape::MATRIX) layout = &matrix;
+
+    PCRenderer buffered(count);
+    PixelRenderer pixels(count);
+    Renderer& renderer = path == Path::STAGED ? static_cast<Renderer&>(pixels) : static_cast<Renderer&>(buffered);
+    Display<8> display(renderer, *layout);
+    std::vector<RGB> work(count);
+    if (path != Path::STAGED) display.setWorkBuffer(work.data(), count);
+
+    Inputs in;
+    addLayers(display, c.mix, in);
+    display.begin();
+    for (uint32_t f = 0; f < FRAMES; ++f) {
+        in.advance(f, c.mix);
+        notifyAt(display, f);
+        if (path == Path::FULL) display.invalidate();
+        display.tick(f * 17);
+        const std::vector<RGB>& leds = path == Path::STAGED ? pixels.leds() : buffered.getLeds();
+        frames.insert(frames.end(), leds.begin(), leds.end());
+    }
+}
+
+uint64_t hashFrames(const std::vector<RGB>& frames) {
+    uint64_t h = 14695981039346656037ull;
+    for (const RGB& px : frames) {
+        h = (h ^ px.r) * 1099511628211ull;
+        h = (h ^ px.g) * 1099511628211ull;
+        h = (h ^ px.b) * 1099511628211ull;
+    }
+    return h;
+}
+
+// First frame and LED where b differs from a, or false if they agree.
+bool firstDifference(const std::vector<RGB>& a, const std::vector<RGB>& b, uint16_t count, uint32_t& frame,
+                     uint16_t& led) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].r != b[i].r || a[i].g != b[i].g || a[i].b != b[i].b) {
+            frame = uint32_t(i / count);
+            led = uint16_t(i % count);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::map<std::string, std::string> loadBaseline(const char* path) {
+    std::map<std::string, std::string> baseline;
+    std::ifstream in(path);
+    std::string name;
+    std::string hash;
+    while (in >> name >> hash) baseline[name] = hash;
+    return baseline;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const char* savePath = nullptr;
+    const char* checkPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--save") && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (!strcmp(argv[i], "--check") && i + 1 < argc) {
+            checkPath = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--save FILE] [--check FILE]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<Case> cases;
+    const Mix mixes[] = {Mix::GRADIENT, Mix::PALETTE_PULSE, Mix::HUE_GAMMA};
+    const uint16_t strips[] = {1, 7, 60, 144};
+    const Shape shapes[] = {Shape::LINEAR, Shape::RING, Shape::RING_CCW};
+    for (Mix mix : mixes) {
+        for (uint16_t leds : strips) {
+            for (Shape shape : shapes) cases.push_back({shape, leds, 1, mix});
+        }
+        cases.push_back({Shape::MATRIX, 7, 3, mix});
+        cases.push_back({Shape::MATRIX, 12, 12, mix});
+    }
+
+    int failures = 0;
+    std::map<std::string, std::string> baseline;
+    if (checkPath) baseline = loadBaseline(checkPath);
+    std::ofstream save;
+    if (savePath) save.open(savePath);
+
+    for (const Case& c : cases) {
+        const uint16_t count = c.width * c.height;
+        const std::string name = caseName(c);
+        std::vector<RGB> buffer, full, staged;
+        render(c, Path::BUFFER, buffer);
+        render(c, Path::FULL, full);
+        render(c, Path::STAGED, staged);
+
+        uint32_t frame;
+        uint16_t led;
+        if (firstDifference(buffer, full, count, frame, led)) {
+            printf("FAIL %s partial redraw differs from full redraw at frame %u led %u\n", name.c_str(),
+                   unsigned(frame), unsigned(led));
+            ++failures;
+        }
+        if (firstDifference(buffer, staged, count, frame, led)) {
+            printf("FAIL %s staged output differs at frame %u led %u\n", name.c_str(), unsigned(frame),
+                   unsigned(led));
+            ++failures;
+        }
+
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashFrames(buffer)));
+        printf("%-28s %s\n", name.c_str(), hash);
+        if (savePath) save << name << " " << hash << "\n";
+        if (checkPath) {
+            auto it = baseline.find(name);
+            if (it == baseline.end()) {
+                printf("FAIL %s missing from %s\n", name.c_str(), checkPath);
+                ++failures;
+            } else if (it->second != hash) {
+                printf("FAIL %s frames changed (%s, baseline %s)\n", name.c_str(), hash, it->second.c_str());
+                ++failures;
+            }
+        }
+    }
+
+    if (checkPath) printf("%d mismatch(es) against %s\n", failures, checkPath);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Simd.h"
+
+namespace LedLayer {
+
+enum class BlendOp : uint8_t {
+    ADD,
+    MULTIPLY,
+    ALPHA,
+    MAX
+};
+
+// Span kernels over the frame buffer. Blocks of 16 pixels go through the
+// SSE2/NEON bodies in Simd.h where available; the rest, and every pixel on
+// other targets, through plain per-channel loops.
+
+inline void fillSpan(RGB* dst, uint16_t count, RGB color) {
+    for (uint16_t i = 0; i < count; ++i) {
+        dst[i] = color;
+    }
+}
+
+inline uint8_t qadd8(uint8_t a, uint8_t b) {
+    uint16_t sum = uint16_t(a) + b;
+    return uint8_t(sum > 255 ? 255 : sum);
+}
+
+inline uint8_t max8(uint8_t a, uint8_t b) {
+    return a > b ? a : b;
+}
+
+inline void addSpan(RGB* dst, uint16_t count, RGB color) {
+    for (uint16_t i = addSpanSimd(dst, count, color); i < count; ++i) {
+        dst[i].r = qadd8(dst[i].r, color.r);
+        dst[i].g = qadd8(dst[i].g, color.g);
+        dst[i].b = qadd8(dst[i].b, color.b);
+    }
+}
+
+inline void multiplySpan(RGB* dst, uint16_t count, RGB color) {
+    const uint16_t r = uint16_t(color.r) + 1;
+    const uint16_t g = uint16_t(color.g) + 1;
+    const uint16_t b = uint16_t(color.b) + 1;
+    for (uint16_t i = multiplySpanSimd(dst, count, color); i < count; ++i) {
+        dst[i].r = uint8_t((dst[i].r * r) >> 8);
+        dst[i].g = uint8_t((dst[i].g * g) >> 8);
+        dst[i].b = uint8_t((dst[i].b * b) >> 8);
+    }
+}
+
+// Mixes color over dst with opacity alpha (255 is opaque).
+inline void alphaSpan(RGB* dst, uint16_t count, RGB color, uint8_t alpha) {
+    const uint16_t a = uint16_t(alpha) + (alpha >> 7);
+    const uint16_t ia = 256 - a;
+    const uint16_t r = color.r * a;
+    const uint16_t g = color.g * a;
+    const uint16_t b = color.b * a;
+    for (uint16_t i = 0; i < count; ++i) {
+        dst[i].r = uint8_t((dst[i].r * ia + r) >> 8);
+        dst[i].g = uint8_t((dst[i].g * ia + g) >> 8);
+        dst[i].b = uint8_t((dst[i].b * ia + b) >> 8);
+    }
+}
+
+// Blends each pixel toward color by its own weight (0 keeps the pixel).
+inline void weightedSpan(RGB* dst, const uint8_t* weights, uint16_t count, RGB color) {
+    for (uint16_t i = 0; i < count; ++i) {
+        uint16_t a = weights[i];
+        if (!a) continue;
+        a += a >> 7;
+        const uint16_t ia = 256 - a;
+        dst[i].r = uint8_t((dst[i].r * ia + color.r * a) >> 8);
+        dst[i].g = uint8_t((dst[i].g * ia + color.g * a) >> 8);
+        dst[i].b = uint8_t((dst[i].b * ia + color.b * a) >> 8);
+    }
+}
+
+inline void maxSpan(RGB* dst, uint16_t count, RGB color) {
+    for (uint16_t i = maxSpanSimd(dst, count, color); i < count; ++i) {
+        dst[i].r = max8(dst[i].r, color.r);
+        dst[i].g = max8(dst[i].g, color.g);
+        dst[i].b = max8(dst[i].b, color.b);
+    }
+}
+
+// Multiplies every channel by scale/256 (scale up to 256).
+inline void scaleSpan(RGB* dst, uint16_t count, uint16_t scale) {
+    for (uint16_t i = scaleSpanSimd(dst, count, scale); i < count; ++i) {
+        dst[i].r = uint8_t((dst[i].r * scale) >> 8);
+        dst[i].g = uint8_t((dst[i].g * scale) >> 8);
+        dst[i].b = uint8_t((dst[i].b * scale) >> 8);
+    }
+}
+
+// Lerps from -> to with weight (positions[i] * step) >> 16 out of 256.
+inline void gradientSpan(RGB* dst, const uint16_t* positions, uint16_t count,
+                         RGB from, RGB to, uint32_t step) {
+    for (uint16_t i = 0; i < count; ++i) {
+        uint32_t w = (uint32_t(positions[i]) * step) >> 16;
+        if (w > 256) w = 256;
+        uint32_t iw = 256 - w;
+        dst[i].r = uint8_t((from.r * iw + to.r * w) >> 8);
+        dst[i].g = uint8_t((from.g * iw + to.g * w) >> 8);
+        dst[i].b = uint8_t((from.b * iw + to.b * w) >> 8);
+    }
+}
+
+inline void blendSpan(RGB* dst, uint16_t count, RGB color, BlendOp op, uint8_t alpha) {
+    switch (op) {
+        case BlendOp::ADD: addSpan(dst, count, color); break;
+        case BlendOp::MULTIPLY: multiplySpan(dst, count, color); break;
+        case BlendOp::ALPHA: alphaSpan(dst, count, color, alpha); break;
+        case BlendOp::MAX: maxSpan(dst, count, color); break;
+    }
+}
+
+}
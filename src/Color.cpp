@@ -1,8 +1,82 @@
 #include "Color.h"
-#include <cmath>
+#include "Flash.h"
 
 namespace LedLayer {
 
+#if LEDLAYER_HUE_TABLE
+namespace {
+
+// hsvToRgb(h, 255, 255) for every hue.
+const RGB HUE_TABLE[256] LEDLAYER_FLASH = {
+    {255, 0, 0}, {255, 6, 0}, {255, 12, 0}, {255, 18, 0},
+    {255, 24, 0}, {255, 30, 0}, {255, 36, 0}, {255, 42, 0},
+    {255, 48, 0}, {255, 54, 0}, {255, 60, 0}, {255, 66, 0},
+    {255, 72, 0}, {255, 78, 0}, {255, 84, 0}, {255, 90, 0},
+    {255, 96, 0}, {255, 102, 0}, {255, 108, 0}, {255, 114, 0},
+    {255, 120, 0}, {255, 126, 0}, {255, 132, 0}, {255, 138, 0},
+    {255, 144, 0}, {255, 150, 0}, {255, 156, 0}, {255, 162, 0},
+    {255, 168, 0}, {255, 174, 0}, {255, 180, 0}, {255, 186, 0},
+    {255, 192, 0}, {255, 198, 0}, {255, 204, 0}, {255, 210, 0},
+    {255, 216, 0}, {255, 222, 0}, {255, 228, 0}, {255, 234, 0},
+    {255, 240, 0}, {255, 246, 0}, {255, 252, 0}, {254, 255, 0},
+    {249, 255, 0}, {243, 255, 0}, {237, 255, 0}, {231, 255, 0},
+    {225, 255, 0}, {219, 255, 0}, {213, 255, 0}, {207, 255, 0},
+    {201, 255, 0}, {195, 255, 0}, {189, 255, 0}, {183, 255, 0},
+    {177, 255, 0}, {171, 255, 0}, {165, 255, 0}, {159, 255, 0},
+    {153, 255, 0}, {147, 255, 0}, {141, 255, 0}, {135, 255, 0},
+    {129, 255, 0}, {123, 255, 0}, {117, 255, 0}, {111, 255, 0},
+    {105, 255, 0}, {99, 255, 0}, {93, 255, 0}, {87, 255, 0},
+    {81, 255, 0}, {75, 255, 0}, {69, 255, 0}, {63, 255, 0},
+    {57, 255, 0}, {51, 255, 0}, {45, 255, 0}, {39, 255, 0},
+    {33, 255, 0}, {27, 255, 0}, {21, 255, 0}, {15, 255, 0},
+    {9, 255, 0}, {3, 255, 0}, {0, 255, 0}, {0, 255, 6},
+    {0, 255, 12}, {0, 255, 18}, {0, 255, 24}, {0, 255, 30},
+    {0, 255, 36}, {0, 255, 42}, {0, 255, 48}, {0, 255, 54},
+    {0, 255, 60}, {0, 255, 66}, {0, 255, 72}, {0, 255, 78},
+    {0, 255, 84}, {0, 255, 90}, {0, 255, 96}, {0, 255, 102},
+    {0, 255, 108}, {0, 255, 114}, {0, 255, 120}, {0, 255, 126},
+    {0, 255, 132}, {0, 255, 138}, {0, 255, 144}, {0, 255, 150},
+    {0, 255, 156}, {0, 255, 162}, {0, 255, 168}, {0, 255, 174},
+    {0, 255, 180}, {0, 255, 186}, {0, 255, 192}, {0, 255, 198},
+    {0, 255, 204}, {0, 255, 210}, {0, 255, 216}, {0, 255, 222},
+    {0, 255, 228}, {0, 255, 234}, {0, 255, 240}, {0, 255, 246},
+    {0, 255, 252}, {0, 254, 255}, {0, 249, 255}, {0, 243, 255},
+    {0, 237, 255}, {0, 231, 255}, {0, 225, 255}, {0, 219, 255},
+    {0, 213, 255}, {0, 207, 255}, {0, 201, 255}, {0, 195, 255},
+    {0, 189, 255}, {0, 183, 255}, {0, 177, 255}, {0, 171, 255},
+    {0, 165, 255}, {0, 159, 255}, {0, 153, 255}, {0, 147, 255},
+    {0, 141, 255}, {0, 135, 255}, {0, 129, 255}, {0, 123, 255},
+    {0, 117, 255}, {0, 111, 255}, {0, 105, 255}, {0, 99, 255},
+    {0, 93, 255}, {0, 87, 255}, {0, 81, 255}, {0, 75, 255},
+    {0, 69, 255}, {0, 63, 255}, {0, 57, 255}, {0, 51, 255},
+    {0, 45, 255}, {0, 39, 255}, {0, 33, 255}, {0, 27, 255},
+    {0, 21, 255}, {0, 15, 255}, {0, 9, 255}, {0, 3, 255},
+    {0, 0, 255}, {6, 0, 255}, {12, 0, 255}, {18, 0, 255},
+    {24, 0, 255}, {30, 0, 255}, {36, 0, 255}, {42, 0, 255},
+    {48, 0, 255}, {54, 0, 255}, {60, 0, 255}, {66, 0, 255},
+    {72, 0, 255}, {78, 0, 255}, {84, 0, 255}, {90, 0, 255},
+    {96, 0, 255}, {102, 0, 255}, {108, 0, 255}, {114, 0, 255},
+    {120, 0, 255}, {126, 0, 255}, {132, 0, 255}, {138, 0, 255},
+    {144, 0, 255}, {150, 0, 255}, {156, 0, 255}, {162, 0, 255},
+    {168, 0, 255}, {174, 0, 255}, {180, 0, 255}, {186, 0, 255},
+    {192, 0, 255}, {198, 0, 255}, {204, 0, 255}, {210, 0, 255},
+    {216, 0, 255}, {222, 0, 255}, {228, 0, 255}, {234, 0, 255},
+    {240, 0, 255}, {246, 0, 255}, {252, 0, 255}, {255, 0, 254},
+    {255, 0, 249}, {255, 0, 243}, {255, 0, 237}, {255, 0, 231},
+    {255, 0, 225}, {255, 0, 219}, {255, 0, 213}, {255, 0, 207},
+    {255, 0, 201}, {255, 0, 195}, {255, 0, 189}, {255, 0, 183},
+    {255, 0, 177}, {255, 0, 171}, {255, 0, 165}, {255, 0, 159},
+    {255, 0, 153}, {255, 0, 147}, {255, 0, 141}, {255, 0, 135},
+    {255, 0, 129}, {255, 0, 123}, {255, 0, 117}, {255, 0, 111},
+    {255, 0, 105}, {255, 0, 99}, {255, 0, 93}, {255, 0, 87},
+    {255, 0, 81}, {255, 0, 75}, {255, 0, 69}, {255, 0, 63},
+    {255, 0, 57}, {255, 0, 51}, {255, 0, 45}, {255, 0, 39},
+    {255, 0, 33}, {255, 0, 27}, {255, 0, 21}, {255, 0, 15},
+};
+
+}
+#endif
+
 RGB hsvToRgb(uint8_t h, uint8_t s, uint8_t v) {
     RGB out;
     if (s == 0) {
@@ -10,8 +84,7 @@ RGB hsvToRgb(uint8_t h, uint8_t s, uint8_t v) {
         return out;
     }
 
-    float region = h / 43.0f;
-    uint8_t i = floor(region);
+    uint8_t i = h / 43;
     uint8_t f = (h % 43) * 6;
 
     uint8_t p = (v * (255 - s)) >> 8;
@@ -30,4 +103,65 @@ RGB hsvToRgb(uint8_t h, uint8_t s, uint8_t v) {
     return out;
 }
 
+RGB rainbowToRgb(uint8_t h, uint8_t s, uint8_t v) {
+    uint8_t offset = uint8_t((h & 31) << 3);
+    uint8_t third = uint8_t((offset * 85) >> 8);
+    uint8_t twoThirds = uint8_t((offset * 170) >> 8);
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    switch (h >> 5) {
+        case 0: r = 255 - third; g = third; break;               // red to orange
+        case 1: r = 171; g = 85 + third; break;                  // orange to yellow
+        case 2: r = 171 - twoThirds; g = 170 + third; break;     // yellow to green
+        case 3: g = 255 - third; b = third; break;               // green to aqua
+        case 4: g = 171 - twoThirds; b = 85 + twoThirds; break;  // aqua to blue
+        case 5: r = third; b = 255 - third; break;               // blue to purple
+        case 6: r = 85 + third; b = 171 - third; break;          // purple to pink
+        default: r = 170 + third; b = 85 - third; break;         // pink to red
+    }
+    if (s != 255) {
+        // Desaturate toward white with a perceptual (squared) floor.
+        uint8_t desat = 255 - s;
+        uint8_t white = uint8_t((desat * (desat + 1)) >> 8);
+        uint16_t keep = 256 - white;
+        r = uint8_t(((r * keep) >> 8) + white);
+        g = uint8_t(((g * keep) >> 8) + white);
+        b = uint8_t(((b * keep) >> 8) + white);
+    }
+    if (v != 255) {
+        uint16_t scale = uint16_t(v) + 1;
+        r = uint8_t((r * scale) >> 8);
+        g = uint8_t((g * scale) >> 8);
+        b = uint8_t((b * scale) >> 8);
+    }
+    return RGB{r, g, b};
+}
+
+RGB hueToRgb(uint8_t h) {
+#if LEDLAYER_HUE_TABLE
+    RGB c;
+    readFlash(&c, HUE_TABLE + h, sizeof(RGB));
+    return c;
+#else
+    return hsvToRgb(h, 255, 255);
+#endif
+}
+
+void hsvToRgb(RGB* dst, const uint8_t* hues, uint16_t count, uint8_t s, uint8_t v) {
+    if (s == 255 && v == 255) {
+        for (uint16_t i = 0; i < count; ++i) dst[i] = hueToRgb(hues[i]);
+        return;
+    }
+    for (uint16_t i = 0; i < count; ++i) dst[i] = hsvToRgb(hues[i], s, v);
+}
+
+void hueSpan(RGB* dst, uint16_t count, uint16_t hue, uint16_t step, uint8_t s, uint8_t v) {
+    const bool full = s == 255 && v == 255;
+    for (uint16_t i = 0; i < count; ++i, hue = uint16_t(hue + step)) {
+        uint8_t h = uint8_t(hue >> 8);
+        dst[i] = full ? hueToRgb(h) : hsvToRgb(h, s, v);
+    }
+}
+
 }
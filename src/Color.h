@@ -2,8 +2,30 @@
 
 #include "Renderer.h"
 
+// Define LEDLAYER_HUE_TABLE=1 to look fully saturated, full-value hues up
+// in a 768-byte LEDLAYER_FLASH table instead of computing them.
+#ifndef LEDLAYER_HUE_TABLE
+#define LEDLAYER_HUE_TABLE 0
+#endif
+
 namespace LedLayer {
 
+// "Spectrum" HSV: six equal hue sectors, integer only.
 RGB hsvToRgb(uint8_t h, uint8_t s, uint8_t v);
 
+// "Rainbow" HSV: eight sectors with a wider yellow and orange band, which
+// looks more even on LEDs than the spectrum's narrow yellow.
+RGB rainbowToRgb(uint8_t h, uint8_t s, uint8_t v);
+
+// hsvToRgb(h, 255, 255), from the hue table when it is compiled in.
+RGB hueToRgb(uint8_t h);
+
+// Converts count hues with one saturation and value, for per-pixel hue
+// fills.
+void hsvToRgb(RGB* dst, const uint8_t* hues, uint16_t count, uint8_t s, uint8_t v);
+
+// Fills count pixels with hues starting at hue and advancing by step per
+// pixel, both 8.8 fixed point (256 is one hue step).
+void hueSpan(RGB* dst, uint16_t count, uint16_t hue, uint16_t step, uint8_t s, uint8_t v);
+
 }
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include "Renderer.h"
+
+#if defined(ARDUINO)
+#include <Udp.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace LedLayer {
+
+// Destination for network renderers. send() transmits one datagram made
+// of header followed by payload, so the payload can point straight into
+// the frame buffer.
+class PacketSink {
+public:
+    virtual bool send(const uint8_t* header, uint16_t headerLen,
+                      const uint8_t* payload, uint16_t payloadLen) = 0;
+
+protected:
+    ~PacketSink() = default;
+};
+
+// Streams frames to a remote pixel controller over DDP (Distributed
+// Display Protocol). The Display composes into `buffer`, which doubles as
+// the packet payload: each packet covers packetPixels consecutive pixels
+// and carries its byte offset, so splitting into packets costs no copy.
+// show() is the sync point: only packets whose pixels changed since they
+// were last sent go out, and the last one carries the DDP push flag.
+// Chunk hashes use `chunkHashes` (one uint32_t per packet) when given,
+// otherwise begin() allocates them.
+class DdpRenderer : public Renderer {
+public:
+    static const uint16_t PORT = 4048;
+    // 1440 payload bytes plus headers fit a 1500-byte Ethernet MTU.
+    static const uint16_t DEFAULT_PACKET_PIXELS = 480;
+
+    DdpRenderer(PacketSink& sink, RGB* buffer, int count,
+                uint16_t packetPixels = DEFAULT_PACKET_PIXELS,
+                uint32_t* chunkHashes = nullptr)
+        : _sink(sink),
+          _buffer(buffer),
+          _count(count),
+          _packetPixels(packetPixels ? packetPixels : DEFAULT_PACKET_PIXELS),
+          _hashes(chunkHashes) {}
+
+    ~DdpRenderer() {
+        if (_ownsHashes) free(_hashes);
+    }
+
+    void begin() override {
+        if (!_hashes && chunkCount() > 0) {
+            _hashes = static_cast<uint32_t*>(malloc(chunkCount() * sizeof(uint32_t)));
+            _ownsHashes = _hashes != nullptr;
+        }
+        resend();
+    }
+
+    RGB getPixel(int index) const override {
+        if (index >= 0 && index < _count) return _buffer[index];
+        return {0, 0, 0};
+    }
+
+    void setPixel(int index, const RGB& color) override {
+        if (index >= 0 && index < _count) _buffer[index] = color;
+    }
+
+    RGB* frameBuffer() override { return _buffer; }
+    int frameSize() const override { return _count; }
+
+    void show() override { showRange(0, _count); }
+
+    // Pixels outside [start, start + count) are unchanged, so only the
+    // packets overlapping the range are hashed.
+    void showRange(int start, int count) override {
+        if (_resendAll || !_hashes) {
+            start = 0;
+            count = _count;
+        }
+        if (start < 0) {
+            count += start;
+            start = 0;
+        }
+        if (start + count > _count) count = _count - start;
+        if (count <= 0) return;
+
+        uint16_t first = uint16_t(start / _packetPixels);
+        uint16_t last = uint16_t((start + count - 1) / _packetPixels);
+        int pending = -1;
+        uint32_t pendingHash = 0;
+        bool sentAll = true;
+        for (uint16_t c = first; c <= last; ++c) {
+            uint32_t hash = chunkHash(c);
+            if (!_resendAll && _hashes && _hashes[c] == hash) continue;
+            if (pending >= 0) sentAll &= sendChunk(uint16_t(pending), pendingHash, false);
+            pending = c;
+            pendingHash = hash;
+        }
+        if (pending >= 0) sentAll &= sendChunk(uint16_t(pending), pendingHash, true);
+        if (sentAll) _resendAll = false;
+    }
+
+    // Sends every packet on the next show(), e.g. after the controller
+    // restarted.
+    void resend() { _resendAll = true; }
+
+    uint32_t packetsSent() const { return _packetsSent; }
+    uint16_t chunkCount() const {
+        return uint16_t((_count + _packetPixels - 1) / _packetPixels);
+    }
+
+private:
+    static const uint8_t FLAG_VER1 = 0x40;
+    static const uint8_t FLAG_PUSH = 0x01;
+    static const uint8_t TYPE_RGB8 = 0x0B;
+    static const uint8_t ID_DISPLAY = 1;
+    static const uint8_t HEADER_SIZE = 10;
+
+    uint32_t chunkHash(uint16_t chunk) const {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(_buffer + chunkStart(chunk));
+        int len = chunkPixels(chunk) * int(sizeof(RGB));
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < len; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    int chunkStart(uint16_t chunk) const { return int(chunk) * _packetPixels; }
+
+    int chunkPixels(uint16_t chunk) const {
+        int remaining = _count - chunkStart(chunk);
+        return remaining < _packetPixels ? remaining : _packetPixels;
+    }
+
+    // A chunk whose send failed keeps its old hash and is retried on the
+    // next show().
+    bool sendChunk(uint16_t chunk, uint32_t hash, bool push) {
+        uint32_t offset = uint32_t(chunkStart(chunk)) * sizeof(RGB);
+        uint16_t len = uint16_t(chunkPixels(chunk) * sizeof(RGB));
+        _sequence = uint8_t(_sequence % 15 + 1);
+        uint8_t header[HEADER_SIZE] = {
+            uint8_t(FLAG_VER1 | (push ? FLAG_PUSH : 0)),
+            _sequence,
+            TYPE_RGB8,
+            ID_DISPLAY,
+            uint8_t(offset >> 24), uint8_t(offset >> 16), uint8_t(offset >> 8), uint8_t(offset),
+            uint8_t(len >> 8), uint8_t(len),
+        };
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(_buffer + chunkStart(chunk));
+        if (!_sink.send(header, HEADER_SIZE, payload, len)) return false;
+        if (_hashes) _hashes[chunk] = hash;
+        ++_packetsSent;
+        return true;
+    }
+
+    PacketSink& _sink;
+    RGB* _buffer;
+    int _count;
+    uint16_t _packetPixels;
+    uint32_t* _hashes;
+    bool _ownsHashes = false;
+    bool _resendAll = true;
+    uint8_t _sequence = 0;
+    uint32_t _packetsSent = 0;
+};
+
+#if defined(ARDUINO)
+
+// Sends through any Arduino UDP implementation (WiFiUDP, EthernetUDP).
+class UdpSink : public PacketSink {
+public:
+    UdpSink(UDP& udp, IPAddress ip, uint16_t port = DdpRenderer::PORT)
+        : _udp(udp), _ip(ip), _port(port) {}
+
+    bool send(const uint8_t* header, uint16_t headerLen,
+              const uint8_t* payload, uint16_t payloadLen) override {
+        if (!_udp.beginPacket(_ip, _port)) return false;
+        _udp.write(header, headerLen);
+        _udp.write(payload, payloadLen);
+        return _udp.endPacket() == 1;
+    }
+
+private:
+    UDP& _udp;
+    IPAddress _ip;
+    uint16_t _port;
+};
+
+#else
+
+// POSIX UDP socket; header and payload go out with one sendmsg().
+class SocketSink : public PacketSink {
+public:
+    SocketSink(const char* ipv4, uint16_t port = DdpRenderer::PORT) {
+        memset(&_addr, 0, sizeof(_addr));
+        _addr.sin_family = AF_INET;
+        _addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, ipv4, &_addr.sin_addr) == 1) {
+            _fd = socket(AF_INET, SOCK_DGRAM, 0);
+        }
+    }
+
+    ~SocketSink() {
+        if (_fd >= 0) close(_fd);
+    }
+
+    SocketSink(const SocketSink&) = delete;
+    SocketSink& operator=(const SocketSink&) = delete;
+
+    bool ok() const { return _fd >= 0; }
+
+    bool send(const uint8_t* header, uint16_t headerLen,
+              const uint8_t* payload, uint16_t payloadLen) override {
+        if (_fd < 0) return false;
+        iovec parts[2];
+        parts[0].iov_base = const_cast<uint8_t*>(header);
+        parts[0].iov_len = headerLen;
+        parts[1].iov_base = const_cast<uint8_t*>(payload);
+        parts[1].iov_len = payloadLen;
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &_addr;
+        msg.msg_namelen = sizeof(_addr);
+        msg.msg_iov = parts;
+        msg.msg_iovlen = 2;
+        return sendmsg(_fd, &msg, 0) == ssize_t(headerLen + payloadLen);
+    }
+
+private:
+    sockaddr_in _addr;
+    int _fd = -1;
+};
+
+#endif
+
+}
@@ -1,44 +1,280 @@
 #pragma once
 
-#pragma once
-
+#include <stddef.h>
+#include "Dither.h"
+#include "Governor.h"
 #include "Layout.h"
 #include "Layer.h"
 #include "Notification.h"
+#include "Power.h"
+#include "Profile.h"
 #include "Renderer.h"
+#include "Stages.h"
 #include "Tracks.h"
 
 namespace LedLayer {
 
-template<uint8_t MAX_LAYERS = 8, uint8_t MAX_NOTIFS = 4>
-class Display {
+// Non-template interface used by DisplayGroup to drive displays of any
+// capacity.
+class DisplayBase {
+public:
+    // Composes the frame for nowMs into the renderer without showing it.
+    // Returns false if the frame was unchanged and nothing was written.
+    virtual bool compose(uint32_t nowMs) = 0;
+
+    // compose() and show(), paced like Display::tick().
+    virtual void tick(uint32_t nowMs) = 0;
+
+    virtual Renderer& renderer() = 0;
+
+    virtual bool notify(const Notification& notif) = 0;
+
+protected:
+    ~DisplayBase() {}
+};
+
+// MODES limits the display to the modes a sketch uses (see modeSet()).
+// Stages and per-pixel branches of other modes are compiled out, and
+// addLayer() rejects layers that need them. MAX_MARKERS bounds both the
+// overlay markers placed per frame (markers, clock hands) and the cached
+// static ones (threshold marks, cardinal ticks); extra markers are dropped.
+template<uint8_t MAX_LAYERS = 8, uint8_t MAX_NOTIFS = 4, ModeSet MODES = ALL_MODES,
+         uint8_t MAX_MARKERS = MAX_OVERLAYS>
+class Display : public DisplayBase {
+    static_assert(MAX_LAYERS > 0, "Display needs room for at least one layer");
+    static_assert(MAX_NOTIFS > 0, "Display needs room for at least one queued notification");
+    static_assert(MAX_MARKERS > 0, "Display needs room for at least one overlay marker");
+
 public:
     Display(Renderer& renderer, Layout& layout);
 
+    // Stores cfg in compact form; only the parameters of cfg.mode are kept.
     bool addLayer(const LayerConfig& cfg);
+    bool addLayer(const CompactLayer& layer);
 
     bool begin();
 
-    bool notify(const Notification& notif);
+    // Shows notif now if it outranks the active notification, otherwise
+    // queues it. Returns false if it was dropped because the queue is full
+    // of more urgent entries.
+    bool notify(const Notification& notif) override;
+
+    void setNotifPolicy(NotifPolicy policy);
+
+    // Pixel storage for renderers that do not expose a frameBuffer(). The
+    // finished frame is handed over with a single writeSpan() per tick.
+    // Layouts with an order() map (matrix, mapped) compose here and scatter
+    // the frame into LED order. Without either buffer, frames are composed
+    // in small chunks on the stack and written through writeSpan(), or
+    // setPixel() per LED for order() layouts.
+    void setWorkBuffer(RGB* pixels, uint16_t count);
+
+    // compose() followed by show() when the frame changed. Use a
+    // DisplayGroup instead when several displays share one output. With a
+    // target frame rate, ticks between due frames return immediately.
+    void tick(uint32_t nowMs) override;
+
+    // Paces tick() to fps frames per second (0 turns pacing off). When the
+    // average cost of compose plus show exceeds budgetUs (default: one
+    // frame interval), the frame degrades step by step; see Degradation.
+    void setTargetFps(uint16_t fps, uint32_t budgetUs = 0) { _governor.setTarget(fps, budgetUs); }
+    Degradation degradation() const { return _governor.level(); }
+    uint16_t achievedFps() const { return _governor.achievedFps(); }
+    uint32_t frameCostUs() const { return _governor.frameCostUs(); }
+    // Time cooperative tasks can use before the next frame is due.
+    uint32_t msUntilNextFrame(uint32_t nowMs) const { return _governor.msUntilNextFrame(nowMs); }
+
+    // Estimates the supply current of every output frame and, with a
+    // milliamps budget, dims frames to stay under it; see PowerLimiter.
+    // volts 0 turns the estimate off. Overlays and notifications are drawn
+    // at full color unless the frame as a whole is over budget.
+    void setPowerBudget(uint8_t volts, uint32_t milliamps);
+    void setPowerModel(const PowerModel& model) { _power.setModel(model); }
+    uint32_t estimatedMilliamps() const { return _power.milliamps(); }
+    uint32_t estimatedMilliwatts() const { return _power.milliwatts(); }
+    // Dimming applied by the budget, in 1/256 steps (256: none).
+    uint16_t powerScale() const { return _power.scale(); }
 
-    void tick(uint32_t nowMs);
+    bool compose(uint32_t nowMs) override;
+
+    Renderer& renderer() override { return _renderer; }
+
+    // Forces the next tick() to recompose and show, e.g. after something
+    // else wrote to the renderer.
+    void invalidate();
+
+    // Output gamma applied to every frame through a 256-entry table. A
+    // BRIGHTNESS_GAMMA layer overrides it with its brightness.gamma.
+    void setGamma(Scalar gamma);
+
+#if LEDLAYER_DITHER
+    // High-depth working buffer of at least layout size pixels. While set,
+    // brightness scaling keeps 8 fractional bits per channel and the
+    // output stage replaces the gamma pass with a 16-bit gamma lookup and
+    // temporal dithering driven by the frame counter, so dim colors
+    // average to their true level instead of banding or dropping to zero.
+    // Frames with a fractional pixel are re-output on every tick. Pass
+    // nullptr to turn dithering off again.
+    void setDitherBuffer(RGB16* pixels, uint16_t count);
+#endif
+
+    // Per-LED sparkle levels for MOTION_TWINKLE, one byte per pixel. Each
+    // frame the levels fade and an xorshift generator lights new LEDs, so
+    // sparkles start and end independently. Without a buffer the pattern
+    // is a stateless hash of the LED index that changes as a whole once
+    // per sparkle lifetime.
+    void setTwinkleBuffer(uint8_t* levels, uint16_t count);
+
+    // Pixels rewritten by the last compose() that returned true. When only
+    // the motion run, overlays or the notification moved, this covers just
+    // their old and new extents. Indexes are LED indexes.
+    DirtyRange dirtyRange() const { return _dirty; }
+
+    // Ticks that were skipped because the frame would not have changed.
+    uint32_t skippedFrames() const { return _skippedFrames; }
+
+#if LEDLAYER_PROFILE
+    // Per-stage timings of tick()/compose(), in profileClock() ticks.
+    const FrameProfile& profile() const { return _profiler.profile(); }
+    void setFrameBudget(uint32_t ticks) { _profiler.setBudget(ticks); }
+    void onProfile(ProfileCallback callback, void* context = nullptr, uint32_t everyFrames = 100) {
+        _profiler.setCallback(callback, context, everyFrames);
+    }
+    void resetProfile() { _profiler.reset(); }
+#endif
 
 private:
+    static constexpr bool HAS_GRADIENT = hasMode(MODES, ModeType::COLOR_VALUE_GRADIENT);
+    static constexpr bool HAS_DENSITY = hasMode(MODES, ModeType::MASK_DENSITY);
+    static constexpr bool HAS_MASKS = hasAnyMode(MODES, MASK_MODES);
+    static constexpr bool HAS_MOTION = hasAnyMode(MODES, MOTION_MODES);
+    static constexpr bool HAS_OVERLAYS = hasAnyMode(MODES, OVERLAY_MODES);
+
     static TrackType modeToTrack(ModeType mode);
     static bool isExclusiveTrack(TrackType track);
+    static bool isExclusiveMode(ModeType mode);
+    void compilePipeline();
+    // Resolved state of one frame, shared by every span composed from it.
+    struct FramePlan {
+        uint16_t n;
+        bool wraps;
+        const uint16_t* positions;
+        RGB16* deep;
+        RGB baseColor;
+        MotionPlan motion;
+        bool twinkleState;
+        MaskRuns mask;
+        const CompactLayer* gradLayer;
+        uint32_t gradEnd;
+        uint32_t gradStep;
+        bool gammaPass;
+        const OverlayMarker* markers;
+        const uint16_t* markerIndex;
+        const uint8_t* markerThickness;
+        uint8_t overlayCount;
+        uint8_t staticCount;
+        bool thinOverlays;
+        NotificationPlan notif;
+    };
+
+    bool composeFrame(uint32_t nowMs);
+    void composeSpan(RGB* out, uint16_t lo, uint16_t hi, const FramePlan& plan);
+    bool stageRange(RGB* fb, const FramePlan* plan, RGB16* deep, uint16_t lo, uint16_t hi, uint16_t trim,
+                    DirtyRange& leds);
+    bool finishPower(RGB* fb, const FramePlan* plan, RGB16* deep, uint16_t n, DirtyRange& leds);
+    void storeSpan(RGB* fb, const RGB* pixels, uint16_t start, uint16_t count, DirtyRange& leds);
+    void cacheMarkers();
+    RGB* resolveFrame(uint16_t n, bool& direct);
+    uint32_t settingsKey() const;
+    MaskRuns resolveMask(const MaskTrack& track, uint16_t n, bool wraps) const;
+    MotionPlan planMotion(const MotionTrack& track, Scalar brightness, uint16_t n, bool wraps) const;
+    bool stepTwinkle(const MotionPlan& plan, uint16_t n);
+    NotificationPlan planNotification(uint16_t n) const;
+    void buildGammaTable(Scalar gamma);
+    RGB16* ditherBuffer(uint16_t n) const;
+    void buildDitherTable(Scalar gamma);
+    bool redither();
+    void ditherFrame(RGB* fb, RGB16* deep, bool direct, uint16_t n, uint16_t lo, uint16_t hi);
+    void flushRange(RGB* fb, bool direct, uint16_t n, uint16_t lo, uint16_t hi);
 
     Renderer& _renderer;
     Layout& _layout;
-    LayerConfig _layers[MAX_LAYERS];
+    RGB* _workBuffer = nullptr;
+    uint16_t _workBufferSize = 0;
+    CompactLayer _layers[MAX_LAYERS];
+    LayerState _layerState[MAX_LAYERS];
     uint8_t _layerCount = 0;
-    int _maxColorPri = -32768;
-    int _maxMaskPri = -32768;
-    int _maxMotionPri = -32768;
+    // Layers that contribute to the frame and their stages, rebuilt by
+    // compilePipeline() whenever the layer set changes.
+    uint8_t _stageLayer[MAX_LAYERS];
+    LayerStage _stages[MAX_LAYERS];
+    uint8_t _stageCount = 0;
+    bool _pipelineValid = false;
+    bool _allShared = false;
+    bool _settled = false;
+    uint32_t _settledKey = 0;   // settingsKey() of the settled frame
+    // Static overlay markers, resolved against the layout by cacheMarkers().
+    MarkerStamp _staticMarkers[MAX_MARKERS];
+    uint8_t _staticCount = 0;
+    uint32_t _staticHash = 0;
+    bool _markersValid = false;
     Notification _activeNotif;
     bool _notifActive = false;
-    Notification _notifQueue[MAX_NOTIFS];
-    uint8_t _notifQueueCount = 0;
+    NotificationQueue<MAX_NOTIFS> _notifQueue;
+    NotifPolicy _notifPolicy = NotifPolicy::DISCARD_PREEMPTED;
     uint32_t _now = 0;
+    uint32_t _motionNow = 0;
+    FrameGovernor _governor;
+    PowerLimiter _power;
+    bool _powerFresh = true;   // pixels being replaced are not in the sums
+    bool _powerDimmable = false;   // the frame has lit content the scale dims
+    uint8_t* _twinkleLevels = nullptr;
+    uint16_t _twinkleSize = 0;
+    uint32_t _twinkleMs = 0;
+    uint32_t _twinkleSpawn = 0;
+    uint32_t _twinkleDecay = 0;
+    uint32_t _twinkleGen = 0;
+    uint32_t _rng = 0x2545F491u;
+    uint32_t _frameHash = 0;
+    uint32_t _baseHash = 0;
+    DirtyRange _decor;
+    DirtyRange _dirty;
+    bool _frameValid = false;
+    uint32_t _skippedFrames = 0;
+    Scalar _outputGamma = 1;
+    Scalar _lutGamma = 1;
+    uint8_t _gammaTable[256];
+    RGB16* _ditherBuffer = nullptr;
+    uint16_t _ditherBufferSize = 0;
+    bool _ditherActive = false;
+    uint8_t _ditherPhase = 0;
+    Scalar _ditherGamma = -1;
+    uint16_t _ditherTable[LEDLAYER_DITHER ? DITHER_TABLE_SIZE : 1];
+#if LEDLAYER_PROFILE
+    Profiler _profiler;
+#endif
+};
+
+// Compile-time SRAM breakdown of a Display, for sizing it to a product:
+//   static_assert(DisplayFootprint<3>::total <= 1024, "display too large");
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS = 4, ModeSet MODES = ALL_MODES,
+         uint8_t MAX_MARKERS = MAX_OVERLAYS>
+struct DisplayFootprint {
+    static constexpr size_t perLayer = sizeof(CompactLayer) + sizeof(LayerState);
+    static constexpr size_t layers = perLayer * MAX_LAYERS;
+    // Part of layers held by the mode parameter unions. Without
+    // LEDLAYER_FLASH_PALETTES the inline palette sets their size.
+    static constexpr size_t params = sizeof(CompactLayer::Params) * MAX_LAYERS;
+    static constexpr size_t notifications = sizeof(NotificationQueue<MAX_NOTIFS>) + sizeof(Notification);
+    static constexpr size_t gammaTable = 256;
+    static constexpr size_t ditherTable = LEDLAYER_DITHER ? DITHER_TABLE_SIZE * sizeof(uint16_t) : 0;
+    static constexpr size_t markers = sizeof(MarkerStamp) * MAX_MARKERS;
+    static constexpr size_t total = sizeof(Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>);
+
+    static_assert(total >= layers + notifications + gammaTable + ditherTable + markers,
+                  "footprint breakdown exceeds sizeof(Display)");
 };
 
 }
+
+#include "DisplayImpl.h"
@@ -0,0 +1,30 @@
+#include "DisplayGroup.h"
+
+namespace LedLayer {
+
+bool DisplayGroup::add(DisplayBase& display) {
+    if (_count >= MAX_GROUP_DISPLAYS) return false;
+    _displays[_count++] = &display;
+    return true;
+}
+
+void DisplayGroup::tick(uint32_t nowMs) {
+    bool changed[MAX_GROUP_DISPLAYS];
+    for (uint8_t i = 0; i < _count; ++i) {
+        changed[i] = _displays[i]->compose(nowMs);
+        if (changed[i]) _displays[i]->renderer().commit();
+    }
+    for (uint8_t i = 0; i < _count; ++i) {
+        if (!changed[i]) continue;
+        const void* bus = _displays[i]->renderer().outputBus();
+        bool shown = false;
+        for (uint8_t j = 0; j < i && !shown; ++j) {
+            shown = changed[j] && _displays[j]->renderer().outputBus() == bus;
+        }
+        if (!shown) {
+            _displays[i]->renderer().show();
+        }
+    }
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Display.h"
+
+namespace LedLayer {
+
+static const uint8_t MAX_GROUP_DISPLAYS = 8;
+
+// Ticks several displays as one frame. Every display is composed and
+// committed first, then each distinct output bus is shown once, so strips
+// driven through FastLED are transmitted together instead of once per
+// display.
+class DisplayGroup {
+public:
+    bool add(DisplayBase& display);
+
+    void tick(uint32_t nowMs);
+
+    uint8_t size() const { return _count; }
+
+private:
+    DisplayBase* _displays[MAX_GROUP_DISPLAYS];
+    uint8_t _count = 0;
+};
+
+}
@@ -0,0 +1,1166 @@
+#pragma once
+
+// Implementation of the Display template, included from Display.h so any
+// MAX_LAYERS/MAX_NOTIFS/MAX_MARKERS combination can be instantiated.
+
+#include <algorithm>
+#include "Layout.h"
+#include "Color.h"
+#include "Scalar.h"
+#include "Stages.h"
+#include <string.h>
+
+namespace LedLayer {
+
+// Pixels composed at a time when there is no frame buffer to compose into.
+static const uint16_t STAGING_PIXELS = 32;
+
+// FNV-1a over the resolved frame state, used to detect unchanged frames.
+static const uint32_t FRAME_HASH_SEED = 2166136261u;
+
+template<typename T>
+inline uint32_t hashValue(uint32_t hash, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    for (uint8_t i = 0; i < sizeof(T); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+inline bool isLit(const RGB& c) {
+    return (c.r | c.g | c.b) != 0;
+}
+
+// Draws thickness pixels from idx, within [lo, hi) and wrapping on rings.
+// out holds pixel lo first; deep is indexed by pixel.
+inline void stampMarker(RGB* out, RGB16* deep, uint16_t idx, uint8_t thickness, RGB color, uint16_t n,
+                        bool wraps, uint16_t lo, uint16_t hi) {
+    for (uint8_t k = 0; k < thickness; ++k) {
+        uint16_t j = idx;
+        if (wraps) {
+            j = (idx + k) % n;
+        } else {
+            if (idx + k >= n) break;
+            j = idx + k;
+        }
+        if (j >= lo && j < hi) {
+            out[j - lo] = color;
+            if (deep) deep[j] = RGB16{0, 0, 0};
+        }
+    }
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::Display(Renderer& renderer, Layout& layout)
+    : _renderer(renderer), _layout(layout) {}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::addLayer(const LayerConfig& cfg) {
+    if (_layerCount >= MAX_LAYERS) return false;
+    return addLayer(CompactLayer(cfg));
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::addLayer(const CompactLayer& layer) {
+    if (_layerCount >= MAX_LAYERS || !hasMode(MODES, layer.mode)) return false;
+    _layers[_layerCount] = layer;
+    _layerState[_layerCount] = LayerState();
+    ++_layerCount;
+    _pipelineValid = false;
+    _frameValid = false;
+    return true;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::begin() {
+    // No strict priority checking at begin(). The highest-priority layer
+    // processed during tick() will win.
+    for (uint8_t i = 0; i < _layerCount; ++i) {
+        _layerState[i].hystState = 0;
+    }
+    compilePipeline();
+    if (!_layout.begin()) return false;
+    cacheMarkers();
+    _frameValid = false;
+    return true;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::setWorkBuffer(RGB* pixels, uint16_t count) {
+    _workBuffer = pixels;
+    _workBufferSize = count;
+    _frameValid = false;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::setTwinkleBuffer(uint8_t* levels, uint16_t count) {
+    _twinkleLevels = levels;
+    _twinkleSize = levels ? count : 0;
+    if (levels) memset(levels, 0, count);
+    _twinkleSpawn = 0;
+    _twinkleDecay = 0;
+    _twinkleMs = _motionNow;
+    _frameValid = false;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::setPowerBudget(uint8_t volts, uint32_t milliamps) {
+    _power.setBudget(volts, milliamps);
+    _frameValid = false;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::invalidate() {
+    _frameValid = false;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::setGamma(Scalar gamma) {
+    _outputGamma = gamma;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::buildGammaTable(Scalar gamma) {
+    for (uint16_t i = 0; i < 256; ++i) {
+        Scalar x = Scalar(int(i)) / Scalar(255);
+        _gammaTable[i] = uint8_t(roundInt(powUnit(x, gamma) * Scalar(255)));
+    }
+    _lutGamma = gamma;
+}
+
+#if LEDLAYER_DITHER
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::setDitherBuffer(RGB16* pixels, uint16_t count) {
+    _ditherBuffer = pixels;
+    _ditherBufferSize = count;
+    _ditherActive = false;
+    _frameValid = false;
+}
+#endif
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+RGB16* Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::ditherBuffer(uint16_t n) const {
+    if (!LEDLAYER_DITHER || !_ditherBuffer || _ditherBufferSize < n) return nullptr;
+    return _ditherBuffer;
+}
+
+// 8.8 input to 8.8 output, so 255.0 maps to 65280.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::buildDitherTable(Scalar gamma) {
+    for (uint16_t i = 0; i < DITHER_TABLE_SIZE && LEDLAYER_DITHER; ++i) {
+        uint16_t x = i < 255 ? i : 255;
+        Scalar p = powUnit(Scalar(int(x)) / Scalar(255), gamma);
+        _ditherTable[i] = uint16_t((uint32_t(toPos(p)) * 65280 + POS_ONE / 2) / POS_ONE);
+    }
+    _ditherGamma = gamma;
+}
+
+// Re-outputs an unchanged frame whose dithered pixels still alternate.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::redither() {
+    uint16_t n = _layout.size();
+    bool direct;
+    RGB* fb = resolveFrame(n, direct);
+    RGB16* deep = ditherBuffer(n);
+    if (!deep) return false;
+    _powerFresh = false;
+    ditherFrame(fb, deep, direct, n, 0, n);
+    return true;
+}
+
+// Dithers [lo, hi) of deep into fb, or the whole frame while pixels
+// outside that range still carry a fraction, and flushes it. Without fb,
+// or to keep the power sums, the output is staged in chunks.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::ditherFrame(RGB* fb, RGB16* deep, bool direct, uint16_t n,
+                                                        uint16_t lo, uint16_t hi) {
+    if (_ditherGamma != _lutGamma) buildDitherTable(_lutGamma);
+    if (_ditherActive) {
+        lo = 0;
+        hi = n;
+    }
+    _dirty = DirtyRange();
+    _dirty.add(lo, hi);
+    if (!fb || _power.enabled()) {
+        DirtyRange leds;
+        _ditherActive = stageRange(fb, nullptr, deep, lo, hi, 256, leds);
+        if (finishPower(fb, nullptr, deep, n, leds)) {
+            lo = 0;
+            hi = n;
+        }
+        if (!fb) _dirty = leds;
+    } else {
+        _ditherActive = ditherSpan(fb + lo, deep + lo, hi - lo, _ditherTable, _ditherPhase, lo);
+    }
+    ++_ditherPhase;
+    if (fb) flushRange(fb, direct, n, lo, hi);
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::flushRange(RGB* fb, bool direct, uint16_t n,
+                                                       uint16_t lo, uint16_t hi) {
+    const uint16_t* order = _layout.order();
+    if (order) {
+        // Composed in position order; scatter to LED order.
+        RGB* out = _renderer.frameBuffer();
+        const bool toBuffer = out && _renderer.frameSize() >= n;
+        DirtyRange leds;
+        for (uint16_t i = lo; i < hi; ++i) {
+            uint16_t led = order[i];
+            if (toBuffer) {
+                out[led] = fb[i];
+            } else {
+                _renderer.setPixel(led, fb[i]);
+            }
+            leds.add(led, led + 1);
+        }
+        _dirty = leds;
+    } else if (!direct) {
+        _renderer.writeSpan(lo, fb + lo, hi - lo);
+    }
+}
+
+// Stages [lo, hi) chunk by chunk: composed from plan, or dithered from
+// deep when plan is nullptr, scaled by trim/256 and stored. Returns whether
+// a dithered pixel still carries a fraction.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::stageRange(RGB* fb, const FramePlan* plan, RGB16* deep,
+                                                                    uint16_t lo, uint16_t hi, uint16_t trim,
+                                                                    DirtyRange& leds) {
+    RGB chunk[STAGING_PIXELS];
+    bool active = false;
+    for (uint16_t c = lo; c < hi; c += STAGING_PIXELS) {
+        const uint16_t len = hi - c < STAGING_PIXELS ? hi - c : STAGING_PIXELS;
+        if (plan) {
+            composeSpan(chunk, c, c + len, *plan);
+        } else {
+            active = ditherSpan(chunk, deep + c, len, _ditherTable, _ditherPhase, c) || active;
+        }
+        if (trim < 256) scaleSpan(chunk, len, trim);
+        storeSpan(fb, chunk, c, len, leds);
+        if (plan) LEDLAYER_PROFILE_LAP(_profiler, OUTPUT);
+    }
+    return active;
+}
+
+// Measures a staged frame against the power budget. An over-budget frame
+// is staged again in full, trimmed to fit, before it is shown; the next
+// frame then redraws in full too, as no partial redraw matches the trimmed
+// pixels. Returns whether the frame was restaged.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::finishPower(RGB* fb, const FramePlan* plan, RGB16* deep,
+                                                                     uint16_t n, DirtyRange& leds) {
+    if (!_power.enabled()) return false;
+    if (_power.frameDone(n, _powerDimmable)) _settled = false;
+    const uint16_t trim = _power.trim();
+    if (trim >= 256) return false;
+    _power.reset();
+    _powerFresh = true;
+    stageRange(fb, plan, deep, 0, n, trim, leds);
+    _power.trimDone(n);
+    _powerFresh = false;
+    _dirty = DirtyRange();
+    _dirty.add(0, n);
+    _decor = _dirty;
+    return true;
+}
+
+// Stores count staged pixels from index start. With fb they are copied in
+// and the power sums swap each pixel as it is overwritten. Without one
+// they go to the renderer: one writeSpan() in strip order, or through the
+// layout's order() map into its frameBuffer(), or setPixel() per LED when
+// it has none. leds collects the LEDs written.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::storeSpan(RGB* fb, const RGB* pixels, uint16_t start,
+                                                                   uint16_t count, DirtyRange& leds) {
+    const bool power = _power.enabled();
+    if (fb) {
+        if (power) {
+            _power.store(fb + start, pixels, count, _powerFresh);
+        } else {
+            memcpy(fb + start, pixels, count * sizeof(RGB));
+        }
+        return;
+    }
+    const uint16_t* order = _layout.order();
+    if (!order && !power) {
+        _renderer.writeSpan(start, pixels, count);
+        leds.add(start, start + count);
+        return;
+    }
+    RGB* out = order ? _renderer.frameBuffer() : nullptr;
+    if (out && _renderer.frameSize() >= _layout.size()) {
+        for (uint16_t i = 0; i < count; ++i) {
+            const uint16_t led = order[start + i];
+            if (power) _power.replace(_powerFresh ? RGB{0, 0, 0} : out[led], pixels[i]);
+            out[led] = pixels[i];
+            leds.add(led, led + 1);
+        }
+        return;
+    }
+    for (uint16_t i = 0; i < count; ++i) {
+        const uint16_t led = order ? order[start + i] : uint16_t(start + i);
+        if (power) _power.replace(_powerFresh ? RGB{0, 0, 0} : _renderer.getPixel(led), pixels[i]);
+        _renderer.setPixel(led, pixels[i]);
+        leds.add(led, led + 1);
+    }
+}
+
+// Display state a frame depends on besides its layers' values: output
+// gamma, degradation level and the cached static markers.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+uint32_t Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::settingsKey() const {
+    uint32_t key = hashValue(FRAME_HASH_SEED, _outputGamma);
+    key = hashValue(key, _governor.level());
+    return hashValue(key, _staticHash);
+}
+
+// The buffer frames are composed in: the renderer's own when it is in LED
+// order, else the work buffer. nullptr means frames are staged in chunks
+// (see storeSpan()).
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+RGB* Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::resolveFrame(uint16_t n, bool& direct) {
+    RGB* fb = _renderer.frameBuffer();
+    if (fb && _renderer.frameSize() >= n && !_layout.order()) {
+        direct = true;
+        return fb;
+    }
+    direct = false;
+    if (_workBuffer && _workBufferSize >= n) return _workBuffer;
+    return nullptr;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::notify(const Notification& notif) {
+    Notification n = notif;
+    n.startMs = _now;
+    if (!_notifActive) {
+        _activeNotif = n;
+        _notifActive = true;
+        return true;
+    }
+    if (sameNotification(n, _activeNotif)) {
+        // Coalesce a repeat into the running notification by extending it.
+        uint32_t elapsed = _now - _activeNotif.startMs;
+        if (elapsed + n.durationMs > _activeNotif.durationMs) {
+            _activeNotif.durationMs = elapsed + n.durationMs;
+        }
+        return true;
+    }
+    if (n.priority >= _activeNotif.priority) {
+        if (_notifPolicy == NotifPolicy::RESUME_PREEMPTED) {
+            uint32_t elapsed = _now - _activeNotif.startMs;
+            if (elapsed < _activeNotif.durationMs) {
+                Notification rest = _activeNotif;
+                rest.durationMs -= elapsed;
+                _notifQueue.push(rest, _now);
+            }
+        }
+        _activeNotif = n;
+        return true;
+    }
+    return _notifQueue.push(n, _now);
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::setNotifPolicy(NotifPolicy policy) {
+    _notifPolicy = policy;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::tick(uint32_t nowMs) {
+    if (!_governor.due(nowMs)) return;
+    const bool governed = _governor.enabled();
+    uint32_t startUs = governed ? governorClockUs() : 0;
+    LEDLAYER_PROFILE_BEGIN(_profiler);
+    if (composeFrame(nowMs)) {
+        _renderer.showRange(_dirty.begin, _dirty.end - _dirty.begin);
+        LEDLAYER_PROFILE_LAP(_profiler, SHOW);
+    }
+    LEDLAYER_PROFILE_END(_profiler);
+    if (governed) _governor.frameDone(governorClockUs() - startUs);
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::compose(uint32_t nowMs) {
+    LEDLAYER_PROFILE_BEGIN(_profiler);
+    bool changed = composeFrame(nowMs);
+    LEDLAYER_PROFILE_END(_profiler);
+    return changed;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::composeFrame(uint32_t nowMs) {
+    _now = nowMs;
+    _motionNow = _governor.motionTime(nowMs);
+
+    if (_notifActive) {
+        uint32_t elapsed = nowMs - _activeNotif.startMs;
+        if (elapsed >= _activeNotif.durationMs) {
+            _notifActive = _notifQueue.pop(_activeNotif, nowMs);
+            if (_notifActive) _activeNotif.startMs = nowMs;
+        }
+    }
+
+    if (!_pipelineValid) compilePipeline();
+    if (!_markersValid) cacheMarkers();
+
+    // When every layer reads a SharedSource, the previous frame had settled
+    // and neither a source nor the display's own settings changed since,
+    // this frame would be identical.
+    const uint32_t settledKey = settingsKey();
+    if (_allShared && _settled && _frameValid && !_notifActive && settledKey == _settledKey) {
+        bool changed = false;
+        for (uint8_t s = 0; s < _stageCount && !changed; ++s) {
+            const LayerState& state = _layerState[_stageLayer[s]];
+            changed = _layers[_stageLayer[s]].sharedSource->sequence() != state.seenSeq;
+        }
+        if (!changed) {
+            if (_ditherActive && redither()) return true;
+            ++_skippedFrames;
+            return false;
+        }
+    }
+
+    OverlayMarker frameMarkers[HAS_OVERLAYS ? MAX_MARKERS : 1];
+    FrameTracks tracks;
+    tracks.brightness.gamma = _outputGamma;
+    tracks.overlay.markers = frameMarkers;
+    tracks.overlay.capacity = HAS_OVERLAYS ? MAX_MARKERS : 0;
+    bool settled = true;
+
+    for (uint8_t s = 0; s < _stageCount; ++s) {
+        const CompactLayer& cfg = _layers[_stageLayer[s]];
+        LayerState& state = _layerState[_stageLayer[s]];
+        if (cfg.sharedSource) state.seenSeq = cfg.sharedSource->sequence();
+        Scalar raw = cfg.read();
+        Scalar mapped = 0;
+        if (cfg.inMax != cfg.inMin) {
+            mapped = (raw - cfg.inMin) / (cfg.inMax - cfg.inMin);
+        }
+        if (cfg.has(LAYER_WRAP)) {
+            mapped = fracPart(mapped);
+        } else if (cfg.has(LAYER_CLAMP)) {
+            if (mapped < Scalar(0)) mapped = 0;
+            if (mapped > Scalar(1)) mapped = 1;
+        }
+
+        Scalar val = mapped;
+        if (cfg.has(LAYER_EMA)) {
+            if (!state.emaInitialized) {
+                state.emaState = val;
+                state.emaInitialized = true;
+                settled = false;
+            } else {
+                Scalar prev = state.emaState;
+                state.emaState = prev + cfg.emaAlpha * (val - prev);
+                val = state.emaState;
+                if (val != prev) settled = false;
+            }
+        }
+
+        Scalar discVal = val;
+        if (cfg.has(LAYER_HYST)) {
+            Scalar prev = state.hystState;
+            Scalar half = cfg.hystBand;
+            if (absScalar(val - prev) <= half) {
+                discVal = prev;
+            } else {
+                discVal = (val > prev) ? Scalar(1) : Scalar(0);
+                settled = settled && discVal == prev;
+                state.hystState = discVal;
+            }
+        }
+
+        _stages[s](cfg, val, discVal, tracks);
+    }
+
+    const ColorTrack& colorTrack = tracks.color;
+    const BrightnessTrack& brightnessTrack = tracks.brightness;
+    const MaskTrack& maskTrack = tracks.mask;
+    const MotionTrack& motionTrack = tracks.motion;
+    const OverlayTrack& overlayTrack = tracks.overlay;
+    const uint8_t overlayCount = HAS_OVERLAYS ? overlayTrack.count : 0;
+    // Only solid motion is independent of time.
+    if (motionTrack.active && motionTrack.pattern != ModeType::MOTION_SOLID) settled = false;
+    _settled = settled;
+    _settledKey = settledKey;
+
+    LEDLAYER_PROFILE_LAP(_profiler, LAYERS);
+
+    uint16_t n = _layout.size();
+    const uint16_t* positions = _layout.positions();
+    bool direct;
+    RGB* fb = resolveFrame(n, direct);
+    if (n > 0 && !positions) return false;
+    RGB16* deep = ditherBuffer(n);
+
+    const bool wraps = _layout.wraps();
+    RGB baseColor = colorTrack.active ? colorTrack.color : RGB{0, 0, 0};
+    Scalar globalBright = brightnessTrack.active ? brightnessTrack.scale : Scalar(1);
+    if (globalBright < Scalar(0)) globalBright = 0;
+    if (globalBright > brightnessTrack.limit) globalBright = brightnessTrack.limit;
+
+    MotionPlan motion = planMotion(motionTrack, globalBright, n, wraps);
+    const bool twinkleState = motion.twinkle && _twinkleLevels && _twinkleSize >= n;
+    if (twinkleState && stepTwinkle(motion, n)) ++_twinkleGen;
+
+    const MaskRuns mask = resolveMask(maskTrack, n, wraps);
+
+    // Gradient weight per position, in 1/256 steps across [0, value].
+    const CompactLayer* gradLayer = nullptr;
+    if (HAS_GRADIENT && colorTrack.active && colorTrack.layer &&
+        colorTrack.layer->mode == ModeType::COLOR_VALUE_GRADIENT && colorTrack.value > Scalar(0)) {
+        gradLayer = colorTrack.layer;
+    }
+    uint32_t gradEnd = gradLayer ? toPos(colorTrack.value) : 0;
+    uint32_t gradStep = gradEnd > 0 ? (uint32_t(256) << 16) / gradEnd : 0;
+
+    // The power scale dims what the brightness scale dims. A frame where
+    // that part is dark does not depend on it and must not ease it up.
+    if (_power.enabled()) {
+        const bool motionLit = motion.runEnd > motion.head || motion.wrapEnd > 0 || motion.twinkle;
+        _powerDimmable = motion.scale > 0 && mask.count > 0 &&
+                         (isLit(baseColor) || gradLayer || (motionLit && isLit(motion.color)));
+        motion.scale = uint16_t((uint32_t(motion.scale) * _power.scale()) >> 8);
+    }
+
+    if (brightnessTrack.gamma != _lutGamma) buildGammaTable(brightnessTrack.gamma);
+    const bool gammaPass = _lutGamma != Scalar(1);
+
+    uint16_t markerIndex[HAS_OVERLAYS ? MAX_MARKERS : 1];
+    uint8_t markerThickness[HAS_OVERLAYS ? MAX_MARKERS : 1];
+    const uint8_t staticCount = HAS_OVERLAYS ? _staticCount : 0;
+    const bool thinOverlays = _governor.level() >= Degradation::THIN_OVERLAYS;
+    for (uint8_t m = 0; m < overlayCount; ++m) {
+        uint32_t markerPos = toPos(overlayTrack.markers[m].pos);
+        if (markerPos > POS_ONE) markerPos = POS_ONE;
+        markerIndex[m] = _layout.entryFromPos(uint16_t(markerPos));
+        markerThickness[m] = thinOverlays ? 1 : overlayTrack.markers[m].thickness;
+    }
+
+    const NotificationPlan notif = planNotification(n);
+
+    // Everything the frame depends on has been resolved; skip composition
+    // and show() when it matches the previous frame.
+    // The target kind is hashed, not the pointer: renderers may move
+    // frameBuffer() between frames as long as it holds the last one.
+    uint32_t hash = FRAME_HASH_SEED;
+    hash = hashValue(hash, uint8_t(fb ? (direct ? 1 : 2) : 0));
+    hash = hashValue(hash, n);
+    hash = hashValue(hash, baseColor);
+    hash = hashValue(hash, motion.scale);
+    hash = hashValue(hash, mask.density);
+    for (uint8_t r = 0; r < mask.count; ++r) {
+        hash = hashValue(hash, mask.runs[r]);
+    }
+    hash = hashValue(hash, gradEnd);
+    hash = hashValue(hash, _lutGamma);
+    if (gradLayer) {
+        hash = hashValue(hash, gradLayer->params.gradient.from);
+        hash = hashValue(hash, gradLayer->params.gradient.to);
+    }
+    if (motion.runEnd > motion.head || motion.wrapEnd > 0 || motion.twinkle) {
+        hash = hashValue(hash, motion.color);
+    }
+    // Static markers never move, so they belong to the base frame.
+    if (staticCount > 0) {
+        hash = hashValue(hash, _staticHash);
+        hash = hashValue(hash, thinOverlays);
+    }
+    // Sparkles are spread over the whole frame.
+    if (twinkleState) {
+        hash = hashValue(hash, _twinkleGen);
+    } else if (motion.twinkle) {
+        hash = hashValue(hash, motion.density);
+        hash = hashValue(hash, motion.slot);
+        hash = hashValue(hash, motion.fade);
+    }
+    // The motion run, overlays and notification only touch a few pixels.
+    // If nothing else changed, only their old and new extents are redrawn.
+    const uint32_t baseHash = hash;
+    DirtyRange decor;
+    if (motion.runEnd > motion.head || motion.wrapEnd > 0) {
+        hash = hashValue(hash, motion.head);
+        hash = hashValue(hash, motion.runEnd);
+        hash = hashValue(hash, motion.wrapEnd);
+        decor.add(motion.head, motion.runEnd);
+        decor.add(0, motion.wrapEnd);
+    }
+    for (uint8_t m = 0; m < overlayCount; ++m) {
+        hash = hashValue(hash, markerIndex[m]);
+        hash = hashValue(hash, markerThickness[m]);
+        hash = hashValue(hash, overlayTrack.markers[m].color);
+        decor.addRun(markerIndex[m], markerThickness[m], n, wraps);
+    }
+    if (notif.draw) {
+        hash = hashValue(hash, notif.mode);
+        hash = hashValue(hash, notif.blend);
+        hash = hashValue(hash, notif.alpha);
+        hash = hashValue(hash, notif.color);
+        hash = hashValue(hash, notif.head);
+        hash = hashValue(hash, notif.length);
+        decor.addRun(notif.head, notif.length, n, wraps);
+    }
+    LEDLAYER_PROFILE_LAP(_profiler, PLAN);
+    if (_frameValid && hash == _frameHash) {
+        if (deep && _ditherActive) {
+            _powerFresh = false;
+            ditherFrame(fb, deep, direct, n, 0, n);
+            return true;
+        }
+        ++_skippedFrames;
+        return false;
+    }
+    DirtyRange dirty;
+    if (_frameValid && baseHash == _baseHash) {
+        dirty = decor;
+        dirty.add(_decor.begin, _decor.end);
+    } else {
+        dirty.add(0, n);
+    }
+    // The power sums swap each pixel as it is stored; a full redraw may
+    // follow foreign writes, so it starts over.
+    _powerFresh = !_frameValid;
+    if (!_frameValid) _power.reset();
+    _frameHash = hash;
+    _baseHash = baseHash;
+    _decor = decor;
+    _frameValid = true;
+    _dirty = dirty;
+    const uint16_t lo = dirty.begin;
+    const uint16_t hi = dirty.end;
+
+    FramePlan plan;
+    plan.n = n;
+    plan.wraps = wraps;
+    plan.positions = positions;
+    plan.deep = deep;
+    plan.baseColor = baseColor;
+    plan.motion = motion;
+    plan.twinkleState = twinkleState;
+    plan.mask = mask;
+    plan.gradLayer = gradLayer;
+    plan.gradEnd = gradEnd;
+    plan.gradStep = gradStep;
+    plan.gammaPass = gammaPass;
+    plan.markers = overlayTrack.markers;
+    plan.markerIndex = markerIndex;
+    plan.markerThickness = markerThickness;
+    plan.overlayCount = overlayCount;
+    plan.staticCount = staticCount;
+    plan.thinOverlays = thinOverlays;
+    plan.notif = notif;
+
+    if (!fb || _power.enabled()) {
+        // Stage the frame in small chunks: there is nothing to compose
+        // into, or the power sums need each old pixel before it is
+        // replaced. Dithered frames are stored by ditherFrame(). The
+        // stages are lapped per chunk and sampled once for the frame.
+        LEDLAYER_PROFILE_SPLITS_BEGIN(_profiler);
+        if (deep) {
+            RGB chunk[STAGING_PIXELS];
+            for (uint16_t c = lo; c < hi; c += STAGING_PIXELS) {
+                const uint16_t len = hi - c < STAGING_PIXELS ? hi - c : STAGING_PIXELS;
+                composeSpan(chunk, c, c + len, plan);
+            }
+            ditherFrame(fb, deep, direct, n, lo, hi);
+        } else {
+            DirtyRange leds;
+            stageRange(fb, &plan, nullptr, lo, hi, 256, leds);
+            uint16_t flushLo = lo;
+            uint16_t flushHi = hi;
+            if (finishPower(fb, &plan, nullptr, n, leds)) {
+                flushLo = 0;
+                flushHi = n;
+            }
+            if (!fb) _dirty = leds;
+            if (fb) flushRange(fb, direct, n, flushLo, flushHi);
+        }
+        LEDLAYER_PROFILE_LAP(_profiler, OUTPUT);
+        LEDLAYER_PROFILE_SPLITS_END(_profiler);
+        return true;
+    }
+
+    composeSpan(fb + lo, lo, hi, plan);
+    if (deep) {
+        ditherFrame(fb, deep, direct, n, lo, hi);
+    } else {
+        flushRange(fb, direct, n, lo, hi);
+    }
+    LEDLAYER_PROFILE_LAP(_profiler, OUTPUT);
+    return true;
+}
+
+// Composes pixels [lo, hi) of the planned frame into out, which holds
+// pixel lo first: cleared gaps, lit runs, markers, the notification and
+// then either the gamma pass or, with a dither buffer, the deep capture.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::composeSpan(RGB* out, uint16_t lo, uint16_t hi,
+                                                                     const FramePlan& p) {
+    const uint16_t n = p.n;
+    const bool wraps = p.wraps;
+    const MotionPlan& motion = p.motion;
+    const MaskRuns& mask = p.mask;
+    const NotificationPlan& notif = p.notif;
+    RGB16* deep = p.deep;
+    if (deep) memset(deep + lo, 0, (hi - lo) * sizeof(RGB16));
+
+    // Unlit gaps between mask runs are cleared in bulk; only lit runs are
+    // composed pixel by pixel.
+    uint16_t cleared = lo;
+    for (uint8_t r = 0; r < mask.count; ++r) {
+        const uint16_t runBegin = mask.runs[r].begin > lo ? mask.runs[r].begin : lo;
+        const uint16_t runEnd = mask.runs[r].end < hi ? mask.runs[r].end : hi;
+        if (runBegin >= runEnd) continue;
+        if (runBegin > cleared) {
+            memset(out + (cleared - lo), 0, (runBegin - cleared) * sizeof(RGB));
+        }
+        cleared = runEnd;
+        RGB* span = out + (runBegin - lo);
+        const uint16_t len = runEnd - runBegin;
+        // Positions are sorted, so the gradient covers a prefix of the run.
+        uint16_t gradPixels = 0;
+        if (p.gradLayer) {
+            gradPixels = runEnd - runBegin;
+            if (p.gradEnd < POS_ONE) {
+                uint16_t stop = _layout.indexAtOrAfter(p.gradEnd + 1);
+                gradPixels = stop <= runBegin ? 0 : (stop < runEnd ? stop - runBegin : len);
+            }
+            gradientSpan(span, p.positions + runBegin, gradPixels, p.gradLayer->params.gradient.from,
+                         p.gradLayer->params.gradient.to, p.gradStep);
+        }
+        fillSpan(span + gradPixels, len - gradPixels, p.baseColor);
+        if (HAS_MOTION) {
+            uint16_t b = motion.head > runBegin ? motion.head : runBegin;
+            uint16_t e = motion.runEnd < runEnd ? motion.runEnd : runEnd;
+            if (b < e) fillSpan(out + (b - lo), e - b, motion.color);
+            e = motion.wrapEnd < runEnd ? motion.wrapEnd : runEnd;
+            if (runBegin < e) fillSpan(span, e - runBegin, motion.color);
+            if (p.twinkleState) {
+                weightedSpan(span, _twinkleLevels + runBegin, len, motion.color);
+            } else if (motion.twinkle && motion.density > 0) {
+                // Weights are built in chunks to keep the stack small.
+                const uint16_t CHUNK = 32;
+                uint8_t weights[CHUNK];
+                for (uint16_t i = 0; i < len; i += CHUNK) {
+                    const uint16_t chunk = len - i < CHUNK ? len - i : CHUNK;
+                    for (uint16_t k = 0; k < chunk; ++k) {
+                        bool lit = twinkleLit(uint16_t(runBegin + i + k), motion.slot, motion.density);
+                        weights[k] = lit ? motion.fade : 0;
+                    }
+                    weightedSpan(span + i, weights, chunk, motion.color);
+                }
+            }
+        }
+        if (motion.scale != 256) {
+            if (deep) {
+                scaleSpanDeep(span, deep + runBegin, len, motion.scale);
+            } else {
+                scaleSpan(span, len, motion.scale);
+            }
+        }
+        if (HAS_DENSITY && mask.density < 256) {
+            // The density pattern restarts at each run's first pixel.
+            uint16_t densityAcc = uint16_t((uint32_t(runBegin - mask.runs[r].begin) * mask.density) & 0xFF);
+            for (uint16_t i = 0; i < len; ++i) {
+                densityAcc += mask.density;
+                if (densityAcc < 256) {
+                    span[i] = RGB{0, 0, 0};
+                    if (deep) deep[runBegin + i] = RGB16{0, 0, 0};
+                } else {
+                    densityAcc -= 256;
+                }
+            }
+        }
+    }
+    if (hi > cleared) {
+        memset(out + (cleared - lo), 0, (hi - cleared) * sizeof(RGB));
+    }
+    LEDLAYER_PROFILE_LAP(_profiler, PIXELS);
+
+    // Static markers go beneath the moving ones.
+    for (uint8_t m = 0; m < p.staticCount; ++m) {
+        const MarkerStamp& sm = _staticMarkers[m];
+        stampMarker(out, deep, sm.index, p.thinOverlays ? 1 : sm.thickness, sm.color, n, wraps, lo, hi);
+    }
+    for (uint8_t m = 0; m < p.overlayCount; ++m) {
+        stampMarker(out, deep, p.markerIndex[m], p.markerThickness[m], p.markers[m].color, n, wraps, lo, hi);
+    }
+    LEDLAYER_PROFILE_LAP(_profiler, OVERLAYS);
+
+    if (notif.draw) {
+        // The run is at most two spans: up to the end of the strip, plus the
+        // part that wraps around on rings.
+        DirtyRange spans[2];
+        uint32_t end = uint32_t(notif.head) + notif.length;
+        spans[0].add(notif.head, uint16_t(end < n ? end : n));
+        if (wraps && end > n) spans[1].add(0, uint16_t(end - n));
+        for (uint8_t k = 0; k < 2; ++k) {
+            uint16_t b = spans[k].begin > lo ? spans[k].begin : lo;
+            uint16_t e = spans[k].end < hi ? spans[k].end : hi;
+            if (b >= e) continue;
+            if (deep) memset(deep + b, 0, (e - b) * sizeof(RGB16));
+            if (notif.mode == NotifMode::OVERRIDE) {
+                fillSpan(out + (b - lo), e - b, notif.color);
+            } else {
+                blendSpan(out + (b - lo), e - b, notif.color, notif.blend, notif.alpha);
+            }
+        }
+    }
+    LEDLAYER_PROFILE_LAP(_profiler, NOTIFICATION);
+
+    if (deep) {
+        captureSpan(out, deep + lo, hi - lo);
+    } else if (p.gammaPass) {
+        for (uint16_t i = 0; i < hi - lo; ++i) {
+            RGB& px = out[i];
+            px.r = _gammaTable[px.r];
+            px.g = _gammaTable[px.g];
+            px.b = _gammaTable[px.b];
+        }
+    }
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+MaskRuns Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::resolveMask(const MaskTrack& track, uint16_t n, bool wraps) const {
+    MaskRuns mask;
+    if (!HAS_MASKS || !track.active) {
+        mask.add(0, n);
+        return mask;
+    }
+    // Lit ranges are [start, end) in layout positions; on rings a range past
+    // 1.0 wraps around to the start.
+    Scalar start = track.start;
+    Scalar end = start + track.amount;
+    switch (track.fillMode) {
+        case FillMode::CENTER: {
+            Scalar halfAmount = track.amount / Scalar(2);
+            start = Scalar(0.5f) - halfAmount;
+            end = Scalar(0.5f) + halfAmount;
+        } break;
+        case FillMode::WINDOW: {
+            Scalar width = track.width;
+            if (width > Scalar(1)) width = 1;
+            if (wraps) {
+                start = fracPart(track.amount - width / Scalar(2));
+            } else {
+                start = track.amount * (Scalar(1) - width);
+            }
+            end = start + width;
+        } break;
+        case FillMode::SEGMENT: {
+            if (track.amount < Scalar(0.5f)) return mask;
+            end = start + track.width;
+        } break;
+        case FillMode::TICKS: {
+            uint8_t slots = track.ticks < MAX_MASK_RUNS ? track.ticks : MAX_MASK_RUNS;
+            uint8_t litTicks = uint8_t(roundInt(track.amount * Scalar(int(slots))));
+            for (uint8_t k = 0; k < litTicks; ++k) {
+                uint16_t idx = _layout.indexAtOrAfter(uint32_t(k) * POS_ONE / slots);
+                mask.add(idx, idx + 1 < n ? idx + 1 : n);
+            }
+            return mask;
+        }
+        case FillMode::DENSITY: {
+            mask.density = toScale(track.amount);
+            mask.add(0, n);
+            return mask;
+        }
+        default:
+            break;
+    }
+    if (wraps && end > Scalar(1)) {
+        mask.add(0, _layout.indexAtOrAfter(toPos(end - Scalar(1))));
+        mask.add(_layout.indexAtOrAfter(toPos(start)), n);
+    } else {
+        if (end > Scalar(1)) end = 1;
+        mask.add(_layout.indexAtOrAfter(toPos(start)), _layout.indexAtOrAfter(toPos(end)));
+    }
+    return mask;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+MotionPlan Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::planMotion(const MotionTrack& track, Scalar brightness,
+                                                       uint16_t n, bool wraps) const {
+    MotionPlan plan;
+    if (!HAS_MOTION || !track.active) {
+        plan.scale = toScale(brightness);
+        return plan;
+    }
+    switch (track.pattern) {
+        case ModeType::MOTION_PULSE: {
+            // Pulse and chase never share a frame, so the pulse curve is
+            // folded into the brightness scale.
+            plan.scale = toScale(brightness * pulseWave(_motionNow));
+        } break;
+        case ModeType::MOTION_BLINK: {
+            // Lit for the first half of each period.
+            plan.scale = toScale(brightness);
+            if (track.speed > Scalar(0)) {
+                uint32_t period = uint32_t(toInt(Scalar(1000) / track.speed));
+                if (period > 1 && _motionNow % period >= period / 2) plan.scale = 0;
+            }
+        } break;
+        case ModeType::MOTION_SCANNER: {
+            // A run bouncing between both ends; one sweep takes a period.
+            plan.scale = toScale(brightness);
+            if (track.segmentPixels == 0 || n == 0) break;
+            uint32_t travel = track.segmentPixels < n ? n - track.segmentPixels : 0;
+            uint32_t head = 0;
+            if (track.speed > Scalar(0) && travel > 0) {
+                uint32_t period = uint32_t(toInt(Scalar(2000) / track.speed));
+                if (period > 0) {
+                    uint32_t t = _motionNow % (2 * period);
+                    uint32_t tri = t < period ? t : 2 * period - t;
+                    head = (tri * travel + period / 2) / period;
+                }
+            }
+            plan.color = track.color;
+            plan.head = uint16_t(head);
+            uint32_t end = head + track.segmentPixels;
+            plan.runEnd = uint16_t(end < n ? end : n);
+        } break;
+        case ModeType::MOTION_TWINKLE: {
+            plan.scale = toScale(brightness);
+            plan.color = track.color;
+            plan.twinkle = true;
+            plan.density = track.density;
+            plan.fade = 255;
+            // A stopped twinkle (lifeMs 0) holds its sparkles.
+            if (track.speed > Scalar(0)) {
+                plan.lifeMs = uint32_t(toInt(Scalar(1000) / track.speed));
+                if (plan.lifeMs == 0) plan.lifeMs = 1;
+                plan.slot = _motionNow / plan.lifeMs;
+                plan.fade = uint8_t(255 - (_motionNow % plan.lifeMs) * 255 / plan.lifeMs);
+            }
+        } break;
+        case ModeType::MOTION_CHASE: {
+            plan.scale = toScale(brightness);
+            if (track.segmentPixels == 0 || n == 0) break;
+            uint32_t chasePos = 0;
+            if (track.speed > Scalar(0)) {
+                uint32_t period = uint32_t(toInt(Scalar(2000) / track.speed));
+                if (period > 0) chasePos = ((_motionNow % period) * uint32_t(POS_ONE) + period / 2) / period;
+            }
+            plan.color = track.color;
+            plan.head = _layout.entryFromPos(uint16_t(chasePos));
+            uint32_t end = uint32_t(plan.head) + track.segmentPixels;
+            plan.runEnd = uint16_t(end < n ? end : n);
+            if (wraps && end > n) {
+                end -= n;
+                plan.wrapEnd = uint16_t(end < n ? end : n);
+            }
+        } break;
+        default:
+            plan.scale = toScale(brightness);
+            break;
+    }
+    return plan;
+}
+
+// Advances the twinkle levels to _motionNow: every level fades by 255 per
+// lifetime and new sparkles are lit at full level so that on average
+// density/256 of the LEDs are sparkling. Returns whether any level changed.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::stepTwinkle(const MotionPlan& plan, uint16_t n) {
+    uint32_t elapsed = _motionNow - _twinkleMs;
+    _twinkleMs = _motionNow;
+    if (elapsed == 0 || n == 0 || plan.lifeMs == 0) return false;
+    if (elapsed > plan.lifeMs) elapsed = plan.lifeMs;
+
+    // Remainders carry over so short frames still fade and spawn.
+    _twinkleDecay += elapsed * 255;
+    const uint32_t decay = _twinkleDecay / plan.lifeMs;
+    _twinkleDecay -= decay * plan.lifeMs;
+    const uint64_t spawnUnit = uint64_t(256) * plan.lifeMs;
+    const uint64_t spawnAcc = _twinkleSpawn + uint64_t(elapsed) * n * plan.density;
+    uint32_t spawn = uint32_t(spawnAcc / spawnUnit);
+    _twinkleSpawn = uint32_t(spawnAcc - spawn * spawnUnit);
+
+    bool changed = false;
+    if (decay > 0) {
+        for (uint16_t i = 0; i < n; ++i) {
+            uint8_t level = _twinkleLevels[i];
+            if (!level) continue;
+            _twinkleLevels[i] = level > decay ? uint8_t(level - decay) : 0;
+            changed = true;
+        }
+    }
+    if (spawn > n) spawn = n;
+    for (uint32_t s = 0; s < spawn; ++s) {
+        uint16_t i = uint16_t(((xorshift32(_rng) >> 16) * n) >> 16);
+        _twinkleLevels[i] = 255;
+        changed = true;
+    }
+    return changed;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+NotificationPlan Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::planNotification(uint16_t n) const {
+    NotificationPlan plan;
+    if (!_notifActive || n == 0) return plan;
+    uint32_t elapsed = _now - _activeNotif.startMs;
+    plan.mode = _activeNotif.mode;
+    plan.blend = _activeNotif.blend;
+    plan.alpha = _activeNotif.alpha;
+    plan.color = _activeNotif.color;
+    plan.length = n;
+    switch (_activeNotif.type) {
+        case NotifType::FLASH: {
+            uint16_t period = (_activeNotif.param == 0 ? 200 : _activeNotif.param);
+            plan.draw = ((elapsed / (period / 2)) % 2) == 0;
+        } break;
+        case NotifType::PULSE: {
+            uint16_t a = toScale(pulseWave(elapsed));
+            plan.color.r = scaleChannel(plan.color.r, a);
+            plan.color.g = scaleChannel(plan.color.g, a);
+            plan.color.b = scaleChannel(plan.color.b, a);
+            plan.draw = true;
+        } break;
+        case NotifType::CHASE: {
+            plan.length = (_activeNotif.param == 0 ? 3 : _activeNotif.param);
+            if (plan.length > n) plan.length = n;
+            const uint32_t period = 1500;
+            uint32_t frac = ((elapsed % period) * uint32_t(POS_ONE) + period / 2) / period;
+            plan.head = _layout.entryFromPos(uint16_t(frac));
+            plan.draw = true;
+        } break;
+    }
+    return plan;
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::compilePipeline() {
+    // Exclusive tracks are decided by priority alone, so their winners are
+    // fixed until the layer set changes: the last layer with the highest
+    // priority, as if each had been evaluated in order. Losers get no stage.
+    const uint8_t NONE = 0xFF;
+    uint8_t winner[5] = {NONE, NONE, NONE, NONE, NONE};
+    for (uint8_t i = 0; i < _layerCount; ++i) {
+        const CompactLayer& cfg = _layers[i];
+        if (!cfg.hasSource()) continue;
+        TrackType track = modeToTrack(cfg.mode);
+        if (!isExclusiveMode(cfg.mode)) continue;
+        uint8_t& w = winner[uint8_t(track)];
+        if (w == NONE || cfg.priority >= _layers[w].priority) w = i;
+    }
+
+    _stageCount = 0;
+    const TrackType exclusive[3] = {TrackType::COLOR, TrackType::MASK, TrackType::MOTION};
+    for (uint8_t t = 0; t < 3; ++t) {
+        uint8_t w = winner[uint8_t(exclusive[t])];
+        if (w == NONE) continue;
+        _stageLayer[_stageCount] = w;
+        _stages[_stageCount++] = stageFor<MODES>(_layers[w].mode);
+    }
+    // Combinable tracks keep layer order, which decides the winning gamma
+    // and the overlay drawing order.
+    for (uint8_t i = 0; i < _layerCount; ++i) {
+        const CompactLayer& cfg = _layers[i];
+        if (!cfg.hasSource() || isExclusiveMode(cfg.mode)) continue;
+        _stageLayer[_stageCount] = i;
+        _stages[_stageCount++] = stageFor<MODES>(cfg.mode);
+    }
+    _allShared = _stageCount > 0;
+    for (uint8_t s = 0; s < _stageCount; ++s) {
+        if (!_layers[_stageLayer[s]].sharedSource) _allShared = false;
+    }
+    _pipelineValid = true;
+    _markersValid = false;
+}
+
+// Resolves the markers of threshold and cardinal tick layers to LED
+// indexes, so frames only stamp them. Runs when the layout is begun and
+// after the layer set changes.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+void Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::cacheMarkers() {
+    _staticCount = 0;
+    _staticHash = FRAME_HASH_SEED;
+    _markersValid = true;
+    if (!HAS_OVERLAYS || _layout.size() == 0) return;
+    const uint8_t SLOTS = MAX_MARKERS > 3 ? MAX_MARKERS : 3;
+    Scalar pos[SLOTS];
+    RGB color[SLOTS];
+    for (uint8_t s = 0; s < _stageCount; ++s) {
+        const CompactLayer& cfg = _layers[_stageLayer[s]];
+        const LayerConfig::OverlayParam& o = cfg.params.overlay;
+        uint8_t count = 0;
+        if (cfg.mode == ModeType::OVERLAY_THRESHOLD_MARKS) {
+            if (o.low >= Scalar(0)) { pos[count] = o.low; color[count++] = o.accent; }
+            if (o.high >= Scalar(0)) { pos[count] = o.high; color[count++] = o.accent; }
+            pos[count] = o.pos;
+            color[count++] = o.color;
+        } else if (cfg.mode == ModeType::OVERLAY_CARDINAL_TICKS) {
+            for (uint8_t t = 0; t < o.ticks && count < SLOTS; ++t) {
+                pos[count] = fracPart(o.pos + Scalar(t) / Scalar(o.ticks));
+                color[count++] = o.color;
+            }
+        }
+        for (uint8_t m = 0; m < count && _staticCount < MAX_MARKERS; ++m) {
+            uint32_t markerPos = toPos(pos[m]);
+            if (markerPos > POS_ONE) markerPos = POS_ONE;
+            MarkerStamp& stamp = _staticMarkers[_staticCount++];
+            stamp.index = _layout.entryFromPos(uint16_t(markerPos));
+            stamp.color = color[m];
+            stamp.thickness = o.thickness;
+            _staticHash = hashValue(_staticHash, stamp.index);
+            _staticHash = hashValue(_staticHash, stamp.color);
+            _staticHash = hashValue(_staticHash, stamp.thickness);
+        }
+    }
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+TrackType Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::modeToTrack(ModeType mode) {
+    switch (mode) {
+        case ModeType::COLOR_STATE_PALETTE:
+        case ModeType::COLOR_BINARY:
+        case ModeType::COLOR_VALUE_GRADIENT:
+        case ModeType::COLOR_VALUE_HUE:
+        case ModeType::COLOR_CATEGORY_PALETTE:
+            return TrackType::COLOR;
+        case ModeType::BRIGHTNESS_VALUE:
+        case ModeType::BRIGHTNESS_BINARY:
+        case ModeType::BRIGHTNESS_GAMMA:
+        case ModeType::BRIGHTNESS_LIMITER:
+            return TrackType::BRIGHTNESS;
+        case ModeType::MASK_FILL:
+        case ModeType::MASK_CENTER_FILL:
+        case ModeType::MASK_WINDOW_POSITION:
+        case ModeType::MASK_TICK_COUNT:
+        case ModeType::MASK_SEGMENT_ENABLE:
+        case ModeType::MASK_DENSITY:
+            return TrackType::MASK;
+        case ModeType::MOTION_SOLID:
+        case ModeType::MOTION_PULSE:
+        case ModeType::MOTION_BLINK:
+        case ModeType::MOTION_CHASE:
+        case ModeType::MOTION_SCANNER:
+        case ModeType::MOTION_TWINKLE:
+        case ModeType::MOTION_SPEED:
+            return TrackType::MOTION;
+        case ModeType::OVERLAY_MARKER_SINGLE:
+        case ModeType::OVERLAY_MARKER_THICK:
+        case ModeType::OVERLAY_THRESHOLD_MARKS:
+        case ModeType::OVERLAY_CLOCK_HANDS:
+        case ModeType::OVERLAY_CARDINAL_TICKS:
+            return TrackType::OVERLAY;
+        default:
+            return TrackType::COLOR;
+    }
+}
+
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::isExclusiveTrack(TrackType track) {
+    return (track == TrackType::COLOR || track == TrackType::MASK || track == TrackType::MOTION);
+}
+
+// MOTION_SPEED scales whichever pattern wins the motion track, so it
+// combines instead of competing.
+template<uint8_t MAX_LAYERS, uint8_t MAX_NOTIFS, ModeSet MODES, uint8_t MAX_MARKERS>
+bool Display<MAX_LAYERS, MAX_NOTIFS, MODES, MAX_MARKERS>::isExclusiveMode(ModeType mode) {
+    return mode != ModeType::MOTION_SPEED && isExclusiveTrack(modeToTrack(mode));
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include "Renderer.h"
+
+// Temporal dithering adds a 514-byte 16-bit gamma table to every Display,
+// so it is opt-in: build with LEDLAYER_DITHER=1 to enable
+// Display::setDitherBuffer().
+#ifndef LEDLAYER_DITHER
+#define LEDLAYER_DITHER 0
+#endif
+
+namespace LedLayer {
+
+// One pixel of the high-depth working buffer. Channels are 8.8 fixed
+// point: the 8-bit value composed so far plus the fraction the brightness
+// scale would otherwise truncate.
+struct RGB16 {
+    uint16_t r;
+    uint16_t g;
+    uint16_t b;
+};
+
+// 257 entries, so 8.8 inputs can interpolate to the next entry.
+static const uint16_t DITHER_TABLE_SIZE = 257;
+
+// Rounding thresholds for successive frames: a bit-reversed 4-bit counter,
+// so any 2, 4, 8 or 16 consecutive frames sample the fraction evenly.
+inline uint8_t ditherThreshold(uint8_t phase) {
+    static const uint8_t THRESHOLDS[16] = {
+        8, 136, 72, 200, 40, 168, 104, 232, 24, 152, 88, 216, 56, 184, 120, 248,
+    };
+    return THRESHOLDS[phase & 15];
+}
+
+// Like scaleSpan(), but keeps the truncated fraction of every channel in
+// deep (dst gets the integer part).
+inline void scaleSpanDeep(RGB* dst, RGB16* deep, uint16_t count, uint16_t scale) {
+    for (uint16_t i = 0; i < count; ++i) {
+        uint16_t r = uint16_t(dst[i].r * scale);
+        uint16_t g = uint16_t(dst[i].g * scale);
+        uint16_t b = uint16_t(dst[i].b * scale);
+        deep[i] = RGB16{r, g, b};
+        dst[i] = RGB{uint8_t(r >> 8), uint8_t(g >> 8), uint8_t(b >> 8)};
+    }
+}
+
+// Merges the composed 8-bit pixels with the fractions kept in deep.
+inline void captureSpan(const RGB* src, RGB16* deep, uint16_t count) {
+    for (uint16_t i = 0; i < count; ++i) {
+        deep[i].r = uint16_t((src[i].r << 8) | (deep[i].r & 0xFF));
+        deep[i].g = uint16_t((src[i].g << 8) | (deep[i].g & 0xFF));
+        deep[i].b = uint16_t((src[i].b << 8) | (deep[i].b & 0xFF));
+    }
+}
+
+inline uint8_t ditherChannel(const uint16_t* table, uint16_t v, uint8_t threshold, uint8_t& frac) {
+    const uint16_t* e = table + (v >> 8);
+    uint32_t out = e[0] + ((uint32_t(e[1] - e[0]) * (v & 0xFF)) >> 8);
+    frac |= uint8_t(out);
+    out += threshold;
+    return out > 0xFFFF ? 255 : uint8_t(out >> 8);
+}
+
+// Gamma-corrects deep through table (scaled so 255.0 maps to 65280) and
+// dithers the result to 8 bits. first is the index of deep[0], so each
+// pixel starts at a different point of the threshold sequence. Returns
+// true if any channel had a fraction, i.e. the output will keep changing
+// from frame to frame.
+inline bool ditherSpan(RGB* dst, const RGB16* deep, uint16_t count, const uint16_t* table,
+                       uint8_t phase, uint16_t first) {
+    uint8_t frac = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        uint8_t t = ditherThreshold(uint8_t(phase + first + i));
+        dst[i].r = ditherChannel(table, deep[i].r, t, frac);
+        dst[i].g = ditherChannel(table, deep[i].g, t, frac);
+        dst[i].b = ditherChannel(table, deep[i].b, t, frac);
+    }
+    return frac != 0;
+}
+
+}
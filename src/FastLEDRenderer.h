@@ -3,12 +3,15 @@
 #if defined(ARDUINO)
 
 #include <FastLED.h>
+#include <string.h>
 #include "Renderer.h"
 
 namespace LedLayer {
 
 template<ESPIChipsets CHIPSET, uint8_t DATA_PIN, EOrder COLOR_ORDER>
 class FastLEDRenderer : public Renderer {
+    static_assert(sizeof(CRGB) == sizeof(RGB), "CRGB and RGB must share a layout");
+
 public:
     FastLEDRenderer(CRGB* leds, int numLeds) : _leds(leds), _numLeds(numLeds) {}
 
@@ -30,10 +33,36 @@ public:
         }
     }
 
+    // FastLED.show() pushes every registered controller, so all
+    // FastLEDRenderers report the same output bus.
     void show() override {
         FastLED.show();
     }
 
+    const void* outputBus() const override {
+        return &FastLED;
+    }
+
+    RGB* frameBuffer() override {
+        return reinterpret_cast<RGB*>(_leds);
+    }
+
+    int frameSize() const override {
+        return _numLeds;
+    }
+
+    void writeSpan(int start, const RGB* colors, int count) override {
+        if (start < 0) {
+            colors -= start;
+            count += start;
+            start = 0;
+        }
+        if (start + count > _numLeds) count = _numLeds - start;
+        if (count > 0) {
+            memcpy(_leds + start, colors, count * sizeof(RGB));
+        }
+    }
+
 private:
     CRGB* _leds;
     int _numLeds;
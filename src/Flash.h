@@ -0,0 +1,24 @@
+#pragma once
+
+// Marks constant tables (palettes, LED coordinate maps) for flash
+// placement. On AVR they are read back with memcpy_P; other targets
+// already map constant data from flash.
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define LEDLAYER_FLASH PROGMEM
+#else
+#include <string.h>
+#define LEDLAYER_FLASH
+#endif
+
+namespace LedLayer {
+
+inline void readFlash(void* dst, const void* src, unsigned size) {
+#if defined(__AVR__)
+    memcpy_P(dst, src, size);
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+namespace LedLayer {
+
+// Microsecond clock used to measure frame cost.
+inline uint32_t governorClockUs() {
+#if defined(ARDUINO)
+    return micros();
+#else
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Steps the governor takes, in order, while frames run over budget.
+enum class Degradation : uint8_t {
+    NONE,
+    COARSE_MOTION,  // motion advances every other frame; frames in between skip
+    THIN_OVERLAYS,  // markers are stamped one pixel wide
+    HALF_RATE       // frames are produced at half the target rate
+};
+
+// Paces Display::tick() to a target frame rate and degrades the frame when
+// its cost (compose plus show) keeps exceeding the budget. Cost is a
+// running average over about eight frames. Each step is held for a few
+// frames, and the governor steps back once cost falls under half the
+// budget, so it settles instead of oscillating.
+class FrameGovernor {
+public:
+    // fps 0 disables pacing. budgetUs 0 uses the whole frame interval.
+    void setTarget(uint16_t fps, uint32_t budgetUs) {
+        _fps = fps;
+        _budgetUs = budgetUs ? budgetUs : (fps ? 1000000u / fps : 0);
+        _started = false;
+        _level = Degradation::NONE;
+        _hold = 0;
+        _costUs = 0;
+        _windowFrames = 0;
+        _achievedFps = 0;
+    }
+
+    bool enabled() const { return _fps != 0; }
+
+    // True if a frame is due at nowMs; schedules the next one. A tick that
+    // arrives late is served and the schedule restarts from it, so missed
+    // frames are dropped rather than bursted.
+    bool due(uint32_t nowMs) {
+        if (!_fps) return true;
+        if (!_started) {
+            _started = true;
+            _nextMs = nowMs;
+            _windowStartMs = nowMs;
+        }
+        if (int32_t(nowMs - _nextMs) < 0) return false;
+        uint8_t steps = _level == Degradation::HALF_RATE ? 2 : 1;
+        for (uint8_t i = 0; i < steps; ++i) advance();
+        if (int32_t(nowMs - _nextMs) >= 0) {
+            _nextMs = nowMs;
+            advance();
+        }
+        ++_windowFrames;
+        uint32_t window = nowMs - _windowStartMs;
+        if (window >= 1000) {
+            _achievedFps = uint16_t((_windowFrames * 1000u + window / 2) / window);
+            _windowFrames = 0;
+            _windowStartMs = nowMs;
+        }
+        return true;
+    }
+
+    void frameDone(uint32_t costUs) {
+        if (!_fps) return;
+        _costUs = _costUs ? _costUs + (int32_t(costUs - _costUs) >> 3) : costUs;
+        if (_hold > 0) {
+            --_hold;
+            return;
+        }
+        if (_costUs > _budgetUs && _level != Degradation::HALF_RATE) {
+            _level = Degradation(uint8_t(_level) + 1);
+            _hold = RAISE_HOLD;
+        } else if (_costUs < _budgetUs / 2 && _level != Degradation::NONE) {
+            _level = Degradation(uint8_t(_level) - 1);
+            _hold = LOWER_HOLD;
+        }
+    }
+
+    Degradation level() const { return _level; }
+
+    // Time the motion track sees: quantized to two frames under
+    // COARSE_MOTION and beyond.
+    uint32_t motionTime(uint32_t nowMs) const {
+        if (!_fps || _level == Degradation::NONE) return nowMs;
+        uint32_t step = 2000u / _fps;
+        return step ? nowMs - nowMs % step : nowMs;
+    }
+
+    // Frames produced per second over the last full second.
+    uint16_t achievedFps() const { return _achievedFps; }
+
+    // Average frame cost in microseconds.
+    uint32_t frameCostUs() const { return _costUs; }
+
+    uint32_t msUntilNextFrame(uint32_t nowMs) const {
+        if (!_fps || !_started) return 0;
+        int32_t wait = int32_t(_nextMs - nowMs);
+        return wait > 0 ? uint32_t(wait) : 0;
+    }
+
+private:
+    static const uint8_t RAISE_HOLD = 8;
+    static const uint8_t LOWER_HOLD = 32;
+
+    // 1000 / fps ms, spreading the remainder so the average rate is exact.
+    void advance() {
+        _nextMs += 1000u / _fps;
+        _remainder += 1000u % _fps;
+        if (_remainder >= _fps) {
+            _remainder -= _fps;
+            ++_nextMs;
+        }
+    }
+
+    uint16_t _fps = 0;
+    uint32_t _budgetUs = 0;
+    bool _started = false;
+    uint32_t _nextMs = 0;
+    uint16_t _remainder = 0;
+    Degradation _level = Degradation::NONE;
+    uint8_t _hold = 0;
+    uint32_t _costUs = 0;
+    uint32_t _windowStartMs = 0;
+    uint32_t _windowFrames = 0;
+    uint16_t _achievedFps = 0;
+};
+
+}
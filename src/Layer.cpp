@@ -0,0 +1,100 @@
+#include "Layer.h"
+#include <string.h>
+
+namespace LedLayer {
+
+CompactLayer::CompactLayer(const LayerConfig& cfg)
+    : source(cfg.source),
+      sharedSource(cfg.sharedSource),
+      inMin(cfg.inMin),
+      inMax(cfg.inMax),
+      emaAlpha(cfg.emaAlpha),
+      hystBand(cfg.hystBand),
+      mode(cfg.mode),
+      flags(0) {
+    if (cfg.priority > INT16_MAX) {
+        priority = INT16_MAX;
+    } else if (cfg.priority < INT16_MIN) {
+        priority = INT16_MIN;
+    } else {
+        priority = int16_t(cfg.priority);
+    }
+    if (cfg.clamp) flags |= LAYER_CLAMP;
+    if (cfg.wrap) flags |= LAYER_WRAP;
+    if (cfg.emaEnabled) flags |= LAYER_EMA;
+    if (cfg.hystEnabled) flags |= LAYER_HYST;
+
+    switch (cfg.mode) {
+        case ModeType::COLOR_STATE_PALETTE:
+        case ModeType::COLOR_CATEGORY_PALETTE:
+#if LEDLAYER_FLASH_PALETTES
+            setFlashPalette(cfg.palette.colors, cfg.palette.count);
+#else
+            params.palette = cfg.palette;
+#endif
+            break;
+        case ModeType::COLOR_BINARY:
+        case ModeType::COLOR_VALUE_GRADIENT:
+            params.gradient = cfg.gradient;
+            break;
+        case ModeType::COLOR_VALUE_HUE:
+            break;
+        case ModeType::BRIGHTNESS_VALUE:
+        case ModeType::BRIGHTNESS_BINARY:
+        case ModeType::BRIGHTNESS_GAMMA:
+        case ModeType::BRIGHTNESS_LIMITER:
+            params.brightness = cfg.brightness;
+            break;
+        case ModeType::MASK_FILL:
+        case ModeType::MASK_CENTER_FILL:
+        case ModeType::MASK_WINDOW_POSITION:
+        case ModeType::MASK_TICK_COUNT:
+        case ModeType::MASK_SEGMENT_ENABLE:
+        case ModeType::MASK_DENSITY:
+            params.mask = cfg.mask;
+            break;
+        case ModeType::MOTION_SOLID:
+        case ModeType::MOTION_PULSE:
+        case ModeType::MOTION_BLINK:
+        case ModeType::MOTION_CHASE:
+        case ModeType::MOTION_SCANNER:
+        case ModeType::MOTION_TWINKLE:
+        case ModeType::MOTION_SPEED:
+            params.motion = cfg.motion;
+            break;
+        case ModeType::OVERLAY_MARKER_SINGLE:
+        case ModeType::OVERLAY_MARKER_THICK:
+        case ModeType::OVERLAY_THRESHOLD_MARKS:
+        case ModeType::OVERLAY_CLOCK_HANDS:
+        case ModeType::OVERLAY_CARDINAL_TICKS:
+            params.overlay = cfg.overlay;
+            break;
+    }
+}
+
+void CompactLayer::setFlashPalette(const RGB* colors, uint8_t count) {
+    params.flashPalette.colors = colors;
+    params.flashPalette.count = colors ? count : 0;
+    flags |= LAYER_FLASH_PALETTE;
+}
+
+uint8_t CompactLayer::paletteCount() const {
+#if LEDLAYER_FLASH_PALETTES
+    return has(LAYER_FLASH_PALETTE) ? params.flashPalette.count : 0;
+#else
+    return has(LAYER_FLASH_PALETTE) ? params.flashPalette.count : params.palette.count;
+#endif
+}
+
+RGB CompactLayer::paletteColor(uint8_t index) const {
+#if !LEDLAYER_FLASH_PALETTES
+    if (!has(LAYER_FLASH_PALETTE)) {
+        return params.palette.colors[index];
+    }
+#endif
+    RGB c;
+    readFlash(&c, params.flashPalette.colors + index, sizeof(RGB));
+    return c;
+}
+
+}
@@ -1,55 +1,151 @@
 #pragma once
 
+#include "Flash.h"
 #include "Mode.h"
 #include "Renderer.h"
+#include "Scalar.h"
+#include "Source.h"
+
+// Build with LEDLAYER_FLASH_PALETTES=1 when every palette lives in flash.
+// LayerConfig::palette then holds a pointer to a LEDLAYER_FLASH color array
+// instead of eight inline colors, and CompactLayer drops the inline copy,
+// so no layer carries palette colors in SRAM.
+#ifndef LEDLAYER_FLASH_PALETTES
+#define LEDLAYER_FLASH_PALETTES 0
+#endif
 
 namespace LedLayer {
 
 struct LayerConfig {
     const float* source = nullptr;
+    // Used instead of source when set, for values written from ISRs or the
+    // other core. Frames are skipped while no shared source changes.
+    const SharedSource* sharedSource = nullptr;
 
-    float inMin = 0.0f;
-    float inMax = 1.0f;
+    // Source range mapped to 0..1. With LEDLAYER_FIXED_POINT, these and
+    // the source values must lie within +-32767 (larger ones saturate),
+    // so a clock should count hours or minutes rather than seconds.
+    Scalar inMin = 0.0f;
+    Scalar inMax = 1.0f;
     bool clamp = true;
     bool wrap = false;
 
     bool emaEnabled = false;
-    float emaAlpha = 0.1f;
-    mutable float emaState = 0;
-    mutable bool emaInitialized = false;
+    Scalar emaAlpha = 0.1f;
 
     bool hystEnabled = false;
-    float hystBand = 0.05f;
-    mutable float hystState = 0;
+    Scalar hystBand = 0.05f;
 
     ModeType mode = ModeType::COLOR_STATE_PALETTE;
 
+#if LEDLAYER_FLASH_PALETTES
+    struct PaletteParam {
+        uint8_t count = 0;
+        const RGB* colors = nullptr;   // LEDLAYER_FLASH array
+    } palette;
+#else
     struct PaletteParam {
         uint8_t count = 0;
         RGB colors[8];
     } palette;
+#endif
     struct GradientParam {
         RGB from = {0, 0, 0};
         RGB to   = {255, 255, 255};
     } gradient;
     struct BrightnessParam {
-        float gamma = 1.0f;
+        Scalar gamma = 1.0f;
     } brightness;
     struct MaskParam {
-        float start = 0.0f;
+        Scalar start = 0.0f;
+        Scalar width = 0.1f;   // MASK_WINDOW_POSITION, MASK_SEGMENT_ENABLE
+        uint8_t ticks = 10;    // MASK_TICK_COUNT slots
     } mask;
     struct MotionParam {
-        uint8_t segmentPixels = 3;
+        uint8_t segmentPixels = 3;  // MOTION_CHASE, MOTION_SCANNER run length
         RGB color = {255, 255, 255};
-        float speed = 1.0f;
+        Scalar speed = 1.0f;
+        uint8_t density = 24;       // MOTION_TWINKLE: LEDs sparkling at once, per 256
     } motion;
     struct OverlayParam {
-        float pos = 0.0f;
+        Scalar pos = 0.0f;     // marker; target mark; 12 o'clock and first tick
         RGB color = {255, 255, 255};
         uint8_t thickness = 1;
+        Scalar low = -1.0f;    // OVERLAY_THRESHOLD_MARKS min/max, omitted if negative
+        Scalar high = -1.0f;
+        RGB accent = {255, 0, 0};   // min/max marks; OVERLAY_CLOCK_HANDS second hand
+        uint8_t ticks = 4;     // OVERLAY_CARDINAL_TICKS
     } overlay;
 
     int priority = 0;
 };
 
+// Bits of CompactLayer::flags.
+static const uint8_t LAYER_CLAMP = 0x01;
+static const uint8_t LAYER_WRAP = 0x02;
+static const uint8_t LAYER_EMA = 0x04;
+static const uint8_t LAYER_HYST = 0x08;
+static const uint8_t LAYER_FLASH_PALETTE = 0x10;
+
+// Filter state that changes every tick, kept apart from the configuration.
+struct LayerState {
+    Scalar emaState = 0;
+    Scalar hystState = 0;
+    SharedSource::Sequence seenSeq = 0;   // sharedSource sequence last read
+    bool emaInitialized = false;
+};
+
+// The form Display stores layers in. Only the parameters of the layer's
+// mode are kept, in a union selected by `mode`, and flags pack the filter
+// switches. Build one from a LayerConfig, or directly when the palette
+// should stay in flash.
+struct CompactLayer {
+    struct FlashPalette {
+        const RGB* colors;   // LEDLAYER_FLASH array
+        uint8_t count;
+    };
+
+    union Params {
+#if LEDLAYER_FLASH_PALETTES
+        Params() : flashPalette() {}
+#else
+        Params() : palette() {}
+
+        LayerConfig::PaletteParam palette;     // COLOR_*_PALETTE
+#endif
+        FlashPalette flashPalette;             // ... with LAYER_FLASH_PALETTE
+        LayerConfig::GradientParam gradient;   // COLOR_VALUE_GRADIENT, COLOR_BINARY
+        LayerConfig::BrightnessParam brightness;
+        LayerConfig::MaskParam mask;
+        LayerConfig::MotionParam motion;
+        LayerConfig::OverlayParam overlay;
+    };
+
+    const float* source = nullptr;
+    const SharedSource* sharedSource = nullptr;
+    Scalar inMin = 0.0f;
+    Scalar inMax = 1.0f;
+    Scalar emaAlpha = 0.1f;
+    Scalar hystBand = 0.05f;
+    int16_t priority = 0;
+    ModeType mode = ModeType::COLOR_STATE_PALETTE;
+    uint8_t flags = LAYER_CLAMP;
+    Params params;
+
+    CompactLayer() {}
+    explicit CompactLayer(const LayerConfig& cfg);
+
+    bool has(uint8_t flag) const { return (flags & flag) != 0; }
+
+    bool hasSource() const { return source || sharedSource; }
+
+    Scalar read() const { return sharedSource ? Scalar(sharedSource->read()) : Scalar(*source); }
+
+    // Uses count colors from a LEDLAYER_FLASH array as the palette.
+    void setFlashPalette(const RGB* colors, uint8_t count);
+
+    uint8_t paletteCount() const;
+    RGB paletteColor(uint8_t index) const;
+};
+
 }
@@ -1,8 +1,93 @@
 #include "Layout.h"
+#include <math.h>
+#include <stdlib.h>
 
 namespace LedLayer {
 
-LinearLayout::LinearLayout(uint16_t count) : _count(count) {}
+namespace {
+
+// Shell sort of (position, index) pairs; ties keep LED order, so the
+// result does not depend on the gap sequence.
+void sortByPosition(uint16_t* positions, uint16_t* order, uint16_t n) {
+    uint16_t gap = 1;
+    while (gap < n / 3) gap = uint16_t(gap * 3 + 1);
+    for (; gap > 0; gap /= 3) {
+        for (uint16_t i = gap; i < n; ++i) {
+            uint16_t pos = positions[i];
+            uint16_t idx = order[i];
+            uint16_t j = i;
+            while (j >= gap && (positions[j - gap] > pos ||
+                                (positions[j - gap] == pos && order[j - gap] > idx))) {
+                positions[j] = positions[j - gap];
+                order[j] = order[j - gap];
+                j -= gap;
+            }
+            positions[j] = pos;
+            order[j] = idx;
+        }
+    }
+}
+
+uint32_t isqrt(uint64_t v) {
+    uint64_t root = 0;
+    uint64_t bit = uint64_t(1) << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return uint32_t(root);
+}
+
+}
+
+Layout::~Layout() {
+    if (_ownsPositions) free(_positions);
+    if (_ownsOrder) free(_order);
+}
+
+bool Layout::begin() {
+    uint16_t n = size();
+    if (!_positions && n > 0) {
+        _positions = static_cast<uint16_t*>(malloc(n * sizeof(uint16_t)));
+        if (!_positions) return false;
+        _ownsPositions = true;
+    }
+    const bool sorted = needsOrder();
+    if (sorted && !_order && n > 0) {
+        _order = static_cast<uint16_t*>(malloc(n * sizeof(uint16_t)));
+        if (!_order) return false;
+        _ownsOrder = true;
+    }
+    for (uint16_t i = 0; i < n; ++i) {
+        _positions[i] = positionOf(i);
+        if (sorted) _order[i] = i;
+    }
+    if (sorted) sortByPosition(_positions, _order, n);
+    return true;
+}
+
+uint16_t Layout::indexAtOrAfter(uint32_t pos) const {
+    uint16_t lo = 0;
+    uint16_t hi = _positions ? size() : 0;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (_positions[mid] < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+LinearLayout::LinearLayout(uint16_t count, uint16_t* positions)
+    : Layout(positions), _count(count) {}
 
 uint16_t LinearLayout::size() const {
     return _count;
@@ -18,8 +103,18 @@ uint16_t LinearLayout::indexFrom01(float t) const {
     return uint16_t(t * (_count - 1));
 }
 
-RingLayout::RingLayout(uint16_t count, uint16_t offset, bool clockwise)
-    : _count(count), _offset(offset), _clockwise(clockwise) {}
+uint16_t LinearLayout::indexFromPos(uint16_t pos) const {
+    if (_count < 2) return 0;
+    return uint16_t(uint32_t(pos) * (_count - 1) / POS_ONE);
+}
+
+uint16_t LinearLayout::positionOf(uint16_t index) const {
+    if (_count < 2) return 0;
+    return uint16_t((uint32_t(index) * POS_ONE + (_count - 1) / 2) / (_count - 1));
+}
+
+RingLayout::RingLayout(uint16_t count, uint16_t offset, bool clockwise, uint16_t* positions)
+    : Layout(positions), _count(count), _offset(count ? offset % count : 0), _clockwise(clockwise) {}
 
 uint16_t RingLayout::size() const {
     return _count;
@@ -37,4 +132,118 @@ uint16_t RingLayout::indexFrom01(float t) const {
     }
 }
 
+uint16_t RingLayout::indexFromPos(uint16_t pos) const {
+    if (_count == 0) return 0;
+    uint16_t step = uint16_t(uint32_t(pos) * _count / POS_ONE);
+    uint32_t idx = _clockwise ? uint32_t(_offset) + step
+                              : uint32_t(_offset) + _count - step;
+    while (idx >= _count) idx -= _count;
+    return uint16_t(idx);
+}
+
+uint16_t RingLayout::positionOf(uint16_t index) const {
+    return uint16_t((uint32_t(index) * POS_ONE + _count / 2) / _count);
+}
+
+PlanarLayout::PlanarLayout(uint16_t count, Projection projection, uint16_t* positions, uint16_t* order)
+    : Layout(positions, order), _count(count), _projection(projection) {}
+
+uint16_t PlanarLayout::size() const {
+    return _count;
+}
+
+bool PlanarLayout::wraps() const {
+    return _projection == Projection::ANGULAR;
+}
+
+uint16_t PlanarLayout::indexFrom01(float t) const {
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    return indexFromPos(uint16_t(t * POS_ONE + 0.5f));
+}
+
+uint16_t PlanarLayout::indexFromPos(uint16_t pos) const {
+    uint16_t i = entryFromPos(pos);
+    const uint16_t* map = order();
+    return map && i < _count ? map[i] : i;
+}
+
+uint16_t PlanarLayout::entryFromPos(uint16_t pos) const {
+    const uint16_t* table = positions();
+    if (_count == 0 || !table) return 0;
+    uint16_t i = indexAtOrAfter(pos);
+    if (i == _count) {
+        if (!wraps()) return i - 1;
+        // Past the last entry the nearest one may be the first, a turn on.
+        uint32_t toLast = pos - table[i - 1];
+        uint32_t toFirst = uint32_t(POS_ONE) - pos + table[0];
+        return toFirst < toLast ? 0 : i - 1;
+    }
+    if (i > 0 && pos - table[i - 1] < table[i] - pos) return i - 1;
+    return i;
+}
+
+uint16_t PlanarLayout::positionOf(uint16_t index) const {
+    uint16_t x, y;
+    coordinatesOf(index, x, y);
+    const int32_t center = POS_ONE / 2;
+    int32_t dx = int32_t(x) - center;
+    int32_t dy = int32_t(y) - center;
+    switch (_projection) {
+        case Projection::HORIZONTAL:
+            return x;
+        case Projection::VERTICAL:
+            return y;
+        case Projection::RADIAL: {
+            // Distance from the center relative to the corner distance.
+            uint64_t r2 = uint64_t(int64_t(dx) * dx + int64_t(dy) * dy);
+            uint32_t r = isqrt(r2 * 2);
+            return uint16_t(r > POS_ONE ? POS_ONE : r);
+        }
+        case Projection::ANGULAR: {
+            if (dx == 0 && dy == 0) return 0;
+            float turns = atan2f(float(dx), float(-dy)) / 6.2831853f;
+            if (turns < 0.0f) turns += 1.0f;
+            uint32_t pos = uint32_t(turns * POS_ONE + 0.5f);
+            return uint16_t(pos >= POS_ONE ? 0 : pos);
+        }
+    }
+    return 0;
+}
+
+bool PlanarLayout::needsOrder() const {
+    return true;
+}
+
+MatrixLayout::MatrixLayout(uint16_t width, uint16_t height, bool serpentine, Projection projection,
+                           uint16_t* positions, uint16_t* order)
+    : PlanarLayout(uint16_t(width * height), projection, positions, order),
+      _width(width),
+      _height(height),
+      _serpentine(serpentine) {}
+
+uint16_t MatrixLayout::indexAt(uint16_t x, uint16_t y) const {
+    if (_serpentine && (y & 1)) x = _width - 1 - x;
+    return uint16_t(y * _width + x);
+}
+
+void MatrixLayout::coordinatesOf(uint16_t index, uint16_t& x, uint16_t& y) const {
+    uint16_t row = index / _width;
+    uint16_t col = index % _width;
+    if (_serpentine && (row & 1)) col = _width - 1 - col;
+    x = _width > 1 ? uint16_t(uint32_t(col) * POS_ONE / (_width - 1)) : POS_ONE / 2;
+    y = _height > 1 ? uint16_t(uint32_t(row) * POS_ONE / (_height - 1)) : POS_ONE / 2;
+}
+
+MappedLayout::MappedLayout(const LedPoint* points, uint16_t count, Projection projection,
+                           uint16_t* positions, uint16_t* order)
+    : PlanarLayout(count, projection, positions, order), _points(points) {}
+
+void MappedLayout::coordinatesOf(uint16_t index, uint16_t& x, uint16_t& y) const {
+    LedPoint p;
+    readFlash(&p, _points + index, sizeof(LedPoint));
+    x = uint16_t(p.x * 257);
+    y = uint16_t(p.y * 257);
+}
+
 }
@@ -6,36 +6,182 @@
 #include <cstdint>
 #endif
 
+#include "Flash.h"
+
 namespace LedLayer {
 
+// Fixed-point positions along a layout: 0 is the start, POS_ONE is 1.0.
+static const uint16_t POS_ONE = 65535;
+
 class Layout {
 public:
-    virtual ~Layout() = default;
+    virtual ~Layout();
     virtual uint16_t size() const = 0;
     virtual bool wraps() const = 0;
     virtual uint16_t indexFrom01(float t) const = 0;
+
+    // Integer counterpart of indexFrom01() for positions scaled to POS_ONE.
+    virtual uint16_t indexFromPos(uint16_t pos) const = 0;
+
+    // Builds the per-LED position table (and the order map for layouts
+    // that need one). Uses the storage passed to the constructor when
+    // given, otherwise allocates it once. Display::begin() calls this;
+    // returns false if a table could not be allocated.
+    bool begin();
+
+    // Position of every table entry along the layout, sorted ascending,
+    // valid after begin().
+    const uint16_t* positions() const { return _positions; }
+
+    // LED index of each table entry, or nullptr when entry i is LED i.
+    // Display composes in table order and scatters through this map.
+    const uint16_t* order() const { return _order; }
+
+    // First index whose position is at or past pos (size() if none), by
+    // binary search over the position table.
+    uint16_t indexAtOrAfter(uint32_t pos) const;
+
+    // Table entry at pos, for lookups made in table order (Display's
+    // markers and chase heads). Same as indexFromPos() when order() is
+    // nullptr, which is the default.
+    virtual uint16_t entryFromPos(uint16_t pos) const { return indexFromPos(pos); }
+
+protected:
+    explicit Layout(uint16_t* positions, uint16_t* order = nullptr)
+        : _positions(positions), _order(order) {}
+
+    // Position of LED index.
+    virtual uint16_t positionOf(uint16_t index) const = 0;
+
+    // True when positions do not increase with the LED index; begin() then
+    // sorts the LEDs by position into order().
+    virtual bool needsOrder() const { return false; }
+
+private:
+    Layout(const Layout&) = delete;
+    Layout& operator=(const Layout&) = delete;
+
+    uint16_t* _positions;
+    uint16_t* _order;
+    bool _ownsPositions = false;
+    bool _ownsOrder = false;
 };
 
 class LinearLayout : public Layout {
 public:
-    explicit LinearLayout(uint16_t count);
+    explicit LinearLayout(uint16_t count, uint16_t* positions = nullptr);
     uint16_t size() const override;
     bool wraps() const override;
     uint16_t indexFrom01(float t) const override;
+    uint16_t indexFromPos(uint16_t pos) const override;
+protected:
+    uint16_t positionOf(uint16_t index) const override;
 private:
     uint16_t _count;
 };
 
 class RingLayout : public Layout {
 public:
-    RingLayout(uint16_t count, uint16_t offset = 0, bool clockwise = true);
+    RingLayout(uint16_t count, uint16_t offset = 0, bool clockwise = true,
+               uint16_t* positions = nullptr);
     uint16_t size() const override;
     bool wraps() const override;
     uint16_t indexFrom01(float t) const override;
+    uint16_t indexFromPos(uint16_t pos) const override;
+protected:
+    uint16_t positionOf(uint16_t index) const override;
 private:
     uint16_t _count;
     uint16_t _offset;
     bool _clockwise;
 };
 
+// How 2-D layouts project LED coordinates onto the 0..1 layout position:
+// left to right, top to bottom, outward from the center, or clockwise
+// from 12 o'clock (which wraps like a ring).
+enum class Projection : uint8_t {
+    HORIZONTAL,
+    VERTICAL,
+    RADIAL,
+    ANGULAR
+};
+
+// Base for layouts whose LEDs sit on a plane. Each LED's projection is
+// computed once in begin() and the LEDs are sorted by it, so value-driven
+// modes see a monotone position table and never do geometry per frame.
+// `order` takes uint16_t[count] storage like `positions`.
+//
+// Position lookups binary-search the sorted table: O(log n), ten steps
+// for a 32 x 32 panel. A bucket index would make them O(1) but costs RAM
+// per layout, and Display does only a few lookups per frame.
+class PlanarLayout : public Layout {
+public:
+    uint16_t size() const override;
+    bool wraps() const override;
+    uint16_t indexFrom01(float t) const override;
+    // LED index of the entry nearest to pos.
+    uint16_t indexFromPos(uint16_t pos) const override;
+    // Table entry nearest to pos, by binary search.
+    uint16_t entryFromPos(uint16_t pos) const override;
+
+    Projection projection() const { return _projection; }
+
+protected:
+    PlanarLayout(uint16_t count, Projection projection, uint16_t* positions, uint16_t* order);
+
+    // Coordinates of LED index, scaled so POS_ONE spans the layout; y
+    // grows downward.
+    virtual void coordinatesOf(uint16_t index, uint16_t& x, uint16_t& y) const = 0;
+
+    uint16_t positionOf(uint16_t index) const override;
+    bool needsOrder() const override;
+
+private:
+    uint16_t _count;
+    Projection _projection;
+};
+
+// width x height panel wired row by row from the top-left LED. Serpentine
+// panels reverse every other row.
+class MatrixLayout : public PlanarLayout {
+public:
+    MatrixLayout(uint16_t width, uint16_t height, bool serpentine = true,
+                 Projection projection = Projection::VERTICAL,
+                 uint16_t* positions = nullptr, uint16_t* order = nullptr);
+
+    uint16_t width() const { return _width; }
+    uint16_t height() const { return _height; }
+
+    // LED index at column x, row y.
+    uint16_t indexAt(uint16_t x, uint16_t y) const;
+
+protected:
+    void coordinatesOf(uint16_t index, uint16_t& x, uint16_t& y) const override;
+
+private:
+    uint16_t _width;
+    uint16_t _height;
+    bool _serpentine;
+};
+
+// Byte coordinates on a 256 x 256 grid, one per LED.
+struct LedPoint {
+    uint8_t x;
+    uint8_t y;
+};
+
+// Arbitrary geometry (spirals, segmented rings, cut panels) from a
+// LEDLAYER_FLASH table of per-LED coordinates.
+class MappedLayout : public PlanarLayout {
+public:
+    MappedLayout(const LedPoint* points, uint16_t count, Projection projection = Projection::ANGULAR,
+                 uint16_t* positions = nullptr, uint16_t* order = nullptr);
+
+protected:
+    void coordinatesOf(uint16_t index, uint16_t& x, uint16_t& y) const override;
+
+private:
+    const LedPoint* _points;
+};
+
 }
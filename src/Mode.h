@@ -47,4 +47,35 @@ enum class ModeType : uint8_t {
     OVERLAY_CARDINAL_TICKS
 };
 
+// A set of modes as a bitmask, used to compile a Display for only the modes
+// a sketch uses, e.g. Display<2, 4, modeSet(ModeType::COLOR_VALUE_GRADIENT,
+// ModeType::MASK_FILL)>.
+typedef uint32_t ModeSet;
+
+static_assert(uint8_t(ModeType::OVERLAY_CARDINAL_TICKS) < 32, "ModeSet has one bit per mode");
+
+constexpr ModeSet modeBit(ModeType mode) { return ModeSet(1) << uint8_t(mode); }
+
+constexpr ModeSet modeSet() { return 0; }
+
+template<typename... Modes>
+constexpr ModeSet modeSet(ModeType mode, Modes... rest) { return modeBit(mode) | modeSet(rest...); }
+
+constexpr bool hasMode(ModeSet set, ModeType mode) { return (set & modeBit(mode)) != 0; }
+constexpr bool hasAnyMode(ModeSet set, ModeSet modes) { return (set & modes) != 0; }
+
+static const ModeSet ALL_MODES = 0xFFFFFFFFu;
+
+static const ModeSet MASK_MODES = modeSet(
+    ModeType::MASK_FILL, ModeType::MASK_CENTER_FILL, ModeType::MASK_WINDOW_POSITION,
+    ModeType::MASK_TICK_COUNT, ModeType::MASK_SEGMENT_ENABLE, ModeType::MASK_DENSITY);
+
+static const ModeSet MOTION_MODES = modeSet(
+    ModeType::MOTION_SOLID, ModeType::MOTION_PULSE, ModeType::MOTION_BLINK, ModeType::MOTION_CHASE,
+    ModeType::MOTION_SCANNER, ModeType::MOTION_TWINKLE, ModeType::MOTION_SPEED);
+
+static const ModeSet OVERLAY_MODES = modeSet(
+    ModeType::OVERLAY_MARKER_SINGLE, ModeType::OVERLAY_MARKER_THICK, ModeType::OVERLAY_THRESHOLD_MARKS,
+    ModeType::OVERLAY_CLOCK_HANDS, ModeType::OVERLAY_CARDINAL_TICKS);
+
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Blend.h"
 #include "Renderer.h"
 
 namespace LedLayer {
@@ -15,6 +16,13 @@ enum class NotifMode : uint8_t {
     OVERLAY
 };
 
+// What happens to the active notification when a higher-priority one
+// preempts it.
+enum class NotifPolicy : uint8_t {
+    DISCARD_PREEMPTED,
+    RESUME_PREEMPTED
+};
+
 struct Notification {
     NotifType type = NotifType::FLASH;
     NotifMode mode = NotifMode::OVERRIDE;
@@ -23,6 +31,127 @@ struct Notification {
     uint32_t durationMs = 500;
     uint8_t priority = 0;
     uint16_t param = 200;
+    // How OVERLAY notifications combine with the frame underneath.
+    BlendOp blend = BlendOp::ADD;
+    uint8_t alpha = 255;
+    // Dropped if still waiting in the queue after this long; 0 waits forever.
+    uint32_t maxWaitMs = 0;
+};
+
+// Two notifications that would render identically.
+inline bool sameNotification(const Notification& a, const Notification& b) {
+    return a.type == b.type && a.mode == b.mode && a.blend == b.blend && a.alpha == b.alpha &&
+           a.priority == b.priority &&
+           a.param == b.param && a.color.r == b.color.r && a.color.g == b.color.g &&
+           a.color.b == b.color.b;
+}
+
+// Fixed-capacity binary heap of pending notifications: highest priority
+// first, then earliest deadline, then arrival order. pop() is O(log n);
+// push() is O(n), as it scans for a duplicate and, when full, scans the
+// leaves for the entry to evict. CAPACITY is small enough that a key
+// index would cost more RAM than the scans cost time.
+template<uint8_t CAPACITY>
+class NotificationQueue {
+public:
+    uint8_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+    void clear() { _count = 0; }
+
+    // Queues n, merging it into a pending duplicate if there is one. When
+    // full, evicts the least urgent entry (always a leaf) if n outranks it.
+    bool push(const Notification& n, uint32_t nowMs) {
+        Entry e;
+        e.notif = n;
+        e.expires = n.maxWaitMs != 0;
+        e.deadline = nowMs + n.maxWaitMs;
+        e.seq = _nextSeq++;
+
+        for (uint8_t i = 0; i < _count; ++i) {
+            Entry& q = _heap[i];
+            if (!sameNotification(q.notif, n)) continue;
+            if (n.durationMs > q.notif.durationMs) q.notif.durationMs = n.durationMs;
+            if (!e.expires) {
+                q.expires = false;
+            } else if (q.expires && int32_t(e.deadline - q.deadline) > 0) {
+                q.deadline = e.deadline;
+            }
+            siftDown(i);
+            return true;
+        }
+
+        if (_count >= CAPACITY) {
+            uint8_t worst = _count / 2;
+            for (uint8_t i = worst + 1; i < _count; ++i) {
+                if (before(_heap[worst], _heap[i])) worst = i;
+            }
+            if (!before(e, _heap[worst])) return false;
+            _heap[worst] = e;
+            siftUp(worst);
+            return true;
+        }
+        _heap[_count] = e;
+        siftUp(_count++);
+        return true;
+    }
+
+    // Removes the most urgent entry that has not passed its deadline.
+    bool pop(Notification& out, uint32_t nowMs) {
+        while (_count > 0) {
+            Entry top = _heap[0];
+            _heap[0] = _heap[--_count];
+            siftDown(0);
+            if (top.expires && int32_t(nowMs - top.deadline) > 0) continue;
+            out = top.notif;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Entry {
+        Notification notif;
+        uint32_t deadline;
+        uint32_t seq;
+        bool expires;
+    };
+
+    static bool before(const Entry& a, const Entry& b) {
+        if (a.notif.priority != b.notif.priority) return a.notif.priority > b.notif.priority;
+        if (a.expires != b.expires) return a.expires;
+        if (a.expires && a.deadline != b.deadline) return int32_t(a.deadline - b.deadline) < 0;
+        return int32_t(a.seq - b.seq) < 0;
+    }
+
+    void siftUp(uint8_t i) {
+        while (i > 0) {
+            uint8_t parent = (i - 1) / 2;
+            if (!before(_heap[i], _heap[parent])) break;
+            Entry tmp = _heap[i];
+            _heap[i] = _heap[parent];
+            _heap[parent] = tmp;
+            i = parent;
+        }
+    }
+
+    void siftDown(uint8_t i) {
+        for (;;) {
+            uint8_t best = i;
+            uint16_t left = 2 * uint16_t(i) + 1;
+            uint16_t right = left + 1;
+            if (left < _count && before(_heap[left], _heap[best])) best = uint8_t(left);
+            if (right < _count && before(_heap[right], _heap[best])) best = uint8_t(right);
+            if (best == i) break;
+            Entry tmp = _heap[i];
+            _heap[i] = _heap[best];
+            _heap[best] = tmp;
+            i = best;
+        }
+    }
+
+    Entry _heap[CAPACITY];
+    uint8_t _count = 0;
+    uint32_t _nextSeq = 0;
 };
 
 }
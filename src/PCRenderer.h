@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Renderer.h"
+#include <cstring>
 #include <vector>
 
 namespace LedLayer {
@@ -26,6 +27,27 @@ public:
 
     void show() override {}
 
+    RGB* frameBuffer() override {
+        return _leds.data();
+    }
+
+    int frameSize() const override {
+        return int(_leds.size());
+    }
+
+    void writeSpan(int start, const RGB* colors, int count) override {
+        int size = int(_leds.size());
+        if (start < 0) {
+            colors -= start;
+            count += start;
+            start = 0;
+        }
+        if (start + count > size) count = size - start;
+        if (count > 0) {
+            std::memcpy(_leds.data() + start, colors, count * sizeof(RGB));
+        }
+    }
+
     const std::vector<RGB>& getLeds() const {
         return _leds;
     }
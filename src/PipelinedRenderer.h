@@ -0,0 +1,236 @@
+#pragma once
+
+#include <string.h>
+#include "Renderer.h"
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#elif !defined(ARDUINO)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace LedLayer {
+
+// Overlaps composition with transmission. Display composes into `buffer`;
+// show() waits until the previous frame has been clocked out, copies the
+// new one into the output renderer and returns, while a transmit task
+// calls output.show() on the other core. Frame N+1 is therefore composed
+// while frame N is on the wire.
+//
+// The compose buffer keeps its contents across show(), so Display's
+// damage tracking keeps working. Runs on ESP32 (FreeRTOS task pinned to
+// `core`, with a stack of `stackBytes`) and on hosts (std::thread);
+// elsewhere show() is synchronous.
+//
+// outputBus() is the output's, so a DisplayGroup shows strips on one
+// FastLED bus once. Such strips must also share one transmit task, or two
+// tasks would drive the bus at once: construct the first with a core and
+// the others with it as `transmitter`. They then queue behind its frames.
+class PipelinedRenderer : public Renderer {
+public:
+    static const uint32_t DEFAULT_STACK_BYTES = 4096;
+
+    PipelinedRenderer(Renderer& output, RGB* buffer, int count, int core = 0,
+                      uint32_t stackBytes = DEFAULT_STACK_BYTES)
+        : _output(output), _buffer(buffer), _count(count), _core(core), _stackBytes(stackBytes),
+          _transmitter(this) {}
+
+    PipelinedRenderer(Renderer& output, RGB* buffer, int count, PipelinedRenderer& transmitter)
+        : _output(output), _buffer(buffer), _count(count), _core(transmitter._core),
+          _stackBytes(transmitter._stackBytes), _transmitter(&transmitter) {}
+
+    PipelinedRenderer(const PipelinedRenderer&) = delete;
+    PipelinedRenderer& operator=(const PipelinedRenderer&) = delete;
+
+    ~PipelinedRenderer() {
+        if (_transmitter == this) {
+            stop();
+        } else {
+            waitIdle();
+        }
+    }
+
+    void begin() override {
+        _output.begin();
+        if (_transmitter == this) start();
+    }
+
+    RGB getPixel(int index) const override {
+        if (index >= 0 && index < _count) return _buffer[index];
+        return {0, 0, 0};
+    }
+
+    void setPixel(int index, const RGB& color) override {
+        if (index >= 0 && index < _count) _buffer[index] = color;
+    }
+
+    RGB* frameBuffer() override { return _buffer; }
+    int frameSize() const override { return _count; }
+
+    const void* outputBus() const override { return _output.outputBus(); }
+
+    // Copies the whole frame into the output once the transmitter is idle,
+    // without showing it; the next show() on the bus sends it.
+    void commit() override {
+        _transmitter->acquire();
+        _output.writeSpan(0, _buffer, _count);
+        _transmitter->release();
+    }
+
+    void show() override { showRange(0, _count); }
+
+    void showRange(int start, int count) override {
+        if (start < 0) {
+            count += start;
+            start = 0;
+        }
+        if (start + count > _count) count = _count - start;
+        if (count < 0) count = 0;
+        PipelinedRenderer& tx = *_transmitter;
+        tx.acquire();
+        _output.writeSpan(start, _buffer + start, count);
+        tx._pendingOutput = &_output;
+        tx._pendingStart = start;
+        tx._pendingCount = count;
+        ++tx._submitted;
+        tx.submit();
+    }
+
+    // Fence API, shared by the renderers of one transmitter. A frame is
+    // free for reuse once completedFrames() has reached the value
+    // submittedFrames() had after its show().
+    uint32_t submittedFrames() const { return _transmitter->_submitted; }
+    uint32_t completedFrames() const { return __atomic_load_n(&_transmitter->_completed, __ATOMIC_ACQUIRE); }
+    bool busy() const { return completedFrames() != submittedFrames(); }
+
+    // Blocks until every submitted frame has been transmitted.
+    void waitIdle() {
+        _transmitter->acquire();
+        _transmitter->release();
+    }
+
+private:
+    void transmit() {
+        _pendingOutput->showRange(_pendingStart, _pendingCount);
+        __atomic_store_n(&_completed, _completed + 1, __ATOMIC_RELEASE);
+    }
+
+#if defined(ESP32)
+    static void taskMain(void* arg) {
+        PipelinedRenderer* self = static_cast<PipelinedRenderer*>(arg);
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            self->transmit();
+            xSemaphoreGive(self->_idle);
+        }
+    }
+
+    void start() {
+        if (_task) return;
+        _idle = xSemaphoreCreateBinary();
+        xSemaphoreGive(_idle);
+        xTaskCreatePinnedToCore(taskMain, "ledlayer-tx", _stackBytes, this, configMAX_PRIORITIES - 2, &_task, _core);
+    }
+
+    void stop() {
+        if (!_task) return;
+        waitIdle();
+        vTaskDelete(_task);
+        vSemaphoreDelete(_idle);
+        _task = nullptr;
+    }
+
+    void acquire() { if (_task) xSemaphoreTake(_idle, portMAX_DELAY); }
+    void release() { if (_task) xSemaphoreGive(_idle); }
+
+    void submit() {
+        if (_task) {
+            xTaskNotifyGive(_task);
+        } else {
+            transmit();
+        }
+    }
+
+    TaskHandle_t _task = nullptr;
+    SemaphoreHandle_t _idle = nullptr;
+#elif !defined(ARDUINO)
+    void threadMain() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            _wake.wait(lock, [this] { return _pending || _quit; });
+            if (!_pending) return;
+            lock.unlock();
+            transmit();
+            lock.lock();
+            _pending = false;
+            _wake.notify_all();
+        }
+    }
+
+    void start() {
+        if (_thread.joinable()) return;
+        _quit = false;
+        _thread = std::thread(&PipelinedRenderer::threadMain, this);
+    }
+
+    void stop() {
+        if (!_thread.joinable()) return;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this] { return !_pending; });
+            _quit = true;
+        }
+        _wake.notify_all();
+        _thread.join();
+    }
+
+    void acquire() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [this] { return !_pending; });
+    }
+
+    void release() {}
+
+    void submit() {
+        if (!_thread.joinable()) {
+            transmit();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending = true;
+        }
+        _wake.notify_all();
+    }
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _pending = false;
+    bool _quit = false;
+#else
+    void start() {}
+    void stop() {}
+    void acquire() {}
+    void release() {}
+    void submit() { transmit(); }
+#endif
+
+    Renderer& _output;
+    RGB* _buffer;
+    int _count;
+    int _core;
+    uint32_t _stackBytes;
+    PipelinedRenderer* _transmitter;
+    Renderer* _pendingOutput = nullptr;
+    int _pendingStart = 0;
+    int _pendingCount = 0;
+    uint32_t _submitted = 0;
+    uint32_t _completed = 0;
+};
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdint.h>
+#include "Renderer.h"
+
+namespace LedLayer {
+
+// Supply current of one LED, in mA per channel at full level plus a
+// constant idle draw. The defaults are the usual WS2812B figures at 5 V.
+struct PowerModel {
+    uint8_t redMa = 16;
+    uint8_t greenMa = 11;
+    uint8_t blueMa = 15;
+    uint8_t idleMa = 1;
+};
+
+// Estimates the supply current of the output frame from running channel
+// sums and dims the display to keep it under a budget. The Display keeps
+// the sums up to date in the loop that stores finished output pixels,
+// which reads each old pixel just before overwriting it. An unchanged
+// frame costs nothing and a moving marker costs a few pixels.
+//
+// A frame measured over budget is trimmed: Display stages it again scaled
+// by trim() before it is shown, so no frame leaves over the budget. The
+// scale is the longer-term dimming applied while composing. An over-budget
+// frame cuts it at once to the proportional level; with more than 1/16
+// headroom it eases back up by an eighth of the gap per frame, but only on
+// frames the scale dims, so a dark stretch does not reset it.
+class PowerLimiter {
+public:
+    // volts 0 turns estimation off. milliamps 0 estimates without limiting.
+    void setBudget(uint8_t volts, uint32_t milliamps) {
+        _volts = volts;
+        _budgetMa = milliamps;
+        _scale = SCALE_ONE;
+        _trim = SCALE_ONE;
+        _drawMa = 0;
+        reset();
+    }
+
+    void setModel(const PowerModel& model) { _model = model; }
+
+    bool enabled() const { return _volts != 0; }
+
+    // Forgets the sums ahead of a full redraw.
+    void reset() {
+        _red = 0;
+        _green = 0;
+        _blue = 0;
+    }
+
+    // Swaps one pixel's contribution for another's.
+    void replace(const RGB& old, const RGB& now) {
+        _red += uint32_t(now.r) - old.r;
+        _green += uint32_t(now.g) - old.g;
+        _blue += uint32_t(now.b) - old.b;
+    }
+
+    // Copies count pixels over dst, swapping each one's contribution in
+    // the same loop. fresh: dst is not in the sums (after reset()).
+    void store(RGB* dst, const RGB* src, uint16_t count, bool fresh) {
+        uint32_t r = _red, g = _green, b = _blue;
+        for (uint16_t i = 0; i < count; ++i) {
+            if (!fresh) {
+                r -= dst[i].r;
+                g -= dst[i].g;
+                b -= dst[i].b;
+            }
+            dst[i] = src[i];
+            r += src[i].r;
+            g += src[i].g;
+            b += src[i].b;
+        }
+        _red = r;
+        _green = g;
+        _blue = b;
+    }
+
+    // Call once per output frame of n LEDs, after its pixels were stored.
+    // dimmable: the frame has lit content the scale applies to. Returns
+    // true if the scale changed, i.e. the next frame will differ.
+    bool frameDone(uint16_t n, bool dimmable) {
+        measure(n);
+        _trim = SCALE_ONE;
+        if (!_budgetMa) return false;
+        const uint16_t previous = _scale;
+        const uint32_t idle = uint32_t(n) * _model.idleMa;
+        const uint32_t avail = _budgetMa > idle ? _budgetMa - idle : 0;
+        const uint32_t variable = _drawMa - idle;
+        if (variable > avail) {
+            _trim = uint16_t(uint64_t(SCALE_ONE) * avail / variable);
+            if (dimmable) _scale = uint16_t(uint64_t(_scale) * avail / variable);
+        } else if (dimmable && _scale < SCALE_ONE && variable < avail - avail / 16) {
+            uint64_t target = variable ? uint64_t(_scale) * avail / variable : SCALE_ONE;
+            if (target > SCALE_ONE) target = SCALE_ONE;
+            _scale += uint16_t((target - _scale + 7) / 8);
+        }
+        return _scale != previous;
+    }
+
+    // Factor in 1/256 steps that brings the frame frameDone() measured
+    // under budget; 256 when it already fits.
+    uint16_t trim() const { return _trim; }
+
+    // Call once the trimmed frame was stored, from reset() sums.
+    void trimDone(uint16_t n) {
+        measure(n);
+        _trim = SCALE_ONE;
+    }
+
+    // Brightness factor in 1/256 steps; 256 leaves the frame as composed.
+    uint16_t scale() const { return _scale; }
+
+    uint32_t milliamps() const { return _drawMa; }
+    uint32_t milliwatts() const { return _drawMa * _volts; }
+
+private:
+    static const uint16_t SCALE_ONE = 256;
+
+    void measure(uint16_t n) {
+        _drawMa = uint32_t(n) * _model.idleMa + channelMa(_red, _model.redMa) +
+                  channelMa(_green, _model.greenMa) + channelMa(_blue, _model.blueMa);
+    }
+
+    static uint32_t channelMa(uint32_t sum, uint8_t fullMa) {
+        return (sum / 255) * fullMa + (sum % 255) * fullMa / 255;
+    }
+
+    PowerModel _model;
+    uint8_t _volts = 0;
+    uint32_t _budgetMa = 0;
+    uint16_t _scale = SCALE_ONE;
+    uint16_t _trim = SCALE_ONE;
+    uint32_t _drawMa = 0;
+    uint32_t _red = 0;
+    uint32_t _green = 0;
+    uint32_t _blue = 0;
+};
+
+}
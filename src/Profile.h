@@ -0,0 +1,167 @@
+#pragma once
+
+#include <stdint.h>
+
+// Per-stage frame timing. Define LEDLAYER_PROFILE=1 (e.g. in build flags)
+// to enable it; when disabled the hooks expand to nothing and Display
+// carries no profiling state.
+#ifndef LEDLAYER_PROFILE
+#define LEDLAYER_PROFILE 0
+#endif
+
+#if LEDLAYER_PROFILE
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+namespace LedLayer {
+
+// Counter used for timing. ESP32/ESP8266 count CPU cycles, other Arduino
+// boards microseconds, and host builds nanoseconds. Define
+// LEDLAYER_PROFILE_CLOCK() to use another source, such as DWT->CYCCNT on
+// Cortex-M.
+inline uint32_t profileClock() {
+#if defined(LEDLAYER_PROFILE_CLOCK)
+    return LEDLAYER_PROFILE_CLOCK();
+#elif defined(ESP32) || defined(ESP8266)
+    return ESP.getCycleCount();
+#elif defined(ARDUINO)
+    return micros();
+#else
+    return uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+enum class ProfileStage : uint8_t {
+    LAYERS,         // notification expiry and the layer pass
+    PLAN,           // motion, mask, gradient and notification plans, hash
+    PIXELS,         // base composition over the dirty range
+    OVERLAYS,
+    NOTIFICATION,
+    OUTPUT,         // gamma pass and writeSpan()
+    SHOW,
+    COUNT
+};
+
+struct StageStats {
+    uint32_t last = 0;
+    uint32_t min = 0;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    uint32_t samples = 0;
+
+    uint32_t average() const { return samples ? uint32_t(total / samples) : 0; }
+
+    void add(uint32_t ticks) {
+        last = ticks;
+        if (samples == 0 || ticks < min) min = ticks;
+        if (ticks > max) max = ticks;
+        total += ticks;
+        ++samples;
+    }
+};
+
+// Timing in profileClock() ticks. A stage only gets a sample in frames
+// that reach it, so skipped frames count toward `frame` but not `stages`.
+struct FrameProfile {
+    StageStats stages[uint8_t(ProfileStage::COUNT)];
+    StageStats frame;
+    uint32_t budget = 0;     // 0 disables overrun counting
+    uint32_t overruns = 0;
+
+    const StageStats& stage(ProfileStage s) const { return stages[uint8_t(s)]; }
+};
+
+typedef void (*ProfileCallback)(const FrameProfile& profile, void* context);
+
+class Profiler {
+public:
+    void beginFrame() {
+        _frameStart = profileClock();
+        _lapStart = _frameStart;
+    }
+
+    void lap(ProfileStage stage) {
+        uint32_t now = profileClock();
+        if (_splitting) {
+            _splits[uint8_t(stage)] += now - _lapStart;
+            _splitMask |= uint8_t(1u << uint8_t(stage));
+        } else {
+            _profile.stages[uint8_t(stage)].add(now - _lapStart);
+        }
+        _lapStart = now;
+    }
+
+    // Between beginSplits() and endSplits() laps are summed per stage, and
+    // each stage lapped gets one sample at endSplits(). Work done in
+    // chunks is thus still broken down by stage.
+    void beginSplits() { _splitting = true; }
+
+    void endSplits() {
+        _splitting = false;
+        for (uint8_t s = 0; s < uint8_t(ProfileStage::COUNT); ++s) {
+            if (_splitMask & (1u << s)) _profile.stages[s].add(_splits[s]);
+            _splits[s] = 0;
+        }
+        _splitMask = 0;
+    }
+
+    void endFrame() {
+        uint32_t elapsed = profileClock() - _frameStart;
+        _profile.frame.add(elapsed);
+        if (_profile.budget && elapsed > _profile.budget) ++_profile.overruns;
+        if (_callback && _every && _profile.frame.samples % _every == 0) {
+            _callback(_profile, _context);
+        }
+    }
+
+    const FrameProfile& profile() const { return _profile; }
+
+    void setBudget(uint32_t ticks) { _profile.budget = ticks; }
+
+    // Calls callback with the accumulated profile every `every` frames.
+    void setCallback(ProfileCallback callback, void* context, uint32_t every) {
+        _callback = callback;
+        _context = context;
+        _every = every;
+    }
+
+    void reset() {
+        uint32_t budget = _profile.budget;
+        _profile = FrameProfile();
+        _profile.budget = budget;
+    }
+
+private:
+    FrameProfile _profile;
+    ProfileCallback _callback = nullptr;
+    void* _context = nullptr;
+    uint32_t _every = 0;
+    uint32_t _frameStart = 0;
+    uint32_t _lapStart = 0;
+    uint32_t _splits[uint8_t(ProfileStage::COUNT)] = {};
+    uint8_t _splitMask = 0;
+    bool _splitting = false;
+};
+
+}
+
+#define LEDLAYER_PROFILE_BEGIN(profiler) (profiler).beginFrame()
+#define LEDLAYER_PROFILE_LAP(profiler, stage) (profiler).lap(ProfileStage::stage)
+#define LEDLAYER_PROFILE_END(profiler) (profiler).endFrame()
+#define LEDLAYER_PROFILE_SPLITS_BEGIN(profiler) (profiler).beginSplits()
+#define LEDLAYER_PROFILE_SPLITS_END(profiler) (profiler).endSplits()
+
+#else
+
+#define LEDLAYER_PROFILE_BEGIN(profiler) ((void)0)
+#define LEDLAYER_PROFILE_LAP(profiler, stage) ((void)0)
+#define LEDLAYER_PROFILE_END(profiler) ((void)0)
+#define LEDLAYER_PROFILE_SPLITS_BEGIN(profiler) ((void)0)
+#define LEDLAYER_PROFILE_SPLITS_END(profiler) ((void)0)
+
+#endif
@@ -0,0 +1,470 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "Display.h"
+#include "Renderer.h"
+#include "Source.h"
+
+#if !defined(ARDUINO)
+#include <stdio.h>
+#endif
+
+namespace LedLayer {
+
+// Byte streams for recordings. Implement these over an SD card file,
+// serial port or similar; FileSink and FileSource cover stdio on hosts.
+class RecordSink {
+public:
+    virtual bool write(const uint8_t* data, uint16_t len) = 0;
+
+protected:
+    ~RecordSink() = default;
+};
+
+class RecordSource {
+public:
+    virtual bool read(uint8_t* data, uint16_t len) = 0;
+
+protected:
+    ~RecordSource() = default;
+};
+
+// Recording format, all integers little-endian:
+//   header  "LLRC", version u8, pixel count u16, input count u8
+//   tick    'T', nowMs u32, input count float32 values
+//   notify  'N', type, mode, r, g, b, durationMs u32, priority, param u16,
+//           blend, alpha, maxWaitMs u32   (sent before the next tick)
+//   frame   'F', ops..., END   (the frame shown by the preceding tick)
+// A frame is coded against the previous one as ops of an op byte and a
+// LEB128 pixel count: SKIP (unchanged), FILL (one RGB repeated) or COPY
+// (that many literal RGBs).
+namespace record {
+
+static const uint8_t MAGIC[4] = {'L', 'L', 'R', 'C'};
+static const uint8_t VERSION = 1;
+static const uint8_t TAG_TICK = 'T';
+static const uint8_t TAG_FRAME = 'F';
+static const uint8_t TAG_NOTIFY = 'N';
+static const uint8_t OP_END = 0;
+static const uint8_t OP_SKIP = 1;
+static const uint8_t OP_FILL = 2;
+static const uint8_t OP_COPY = 3;
+static const uint8_t MAX_INPUTS = 16;
+
+inline bool samePixel(const RGB& a, const RGB& b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+}
+
+// Renderer decorator that records every shown frame, delta and run-length
+// coded against the previous one, to a RecordSink before passing it on.
+// Call beginTick() with the value passed to Display::tick() just before
+// it, so the tick's time and the watched inputs are recorded too, and
+// send notifications through notify() so they replay at the same point.
+// `previous` is count pixels of storage for the last recorded frame.
+class RecordingRenderer : public Renderer {
+public:
+    RecordingRenderer(Renderer& output, RecordSink& sink, RGB* previous, int count)
+        : _output(output), _sink(sink), _previous(previous), _count(count) {}
+
+    // Registers a layer source to sample at every tick, in replay order.
+    bool addInput(const float* source) { return addInput(source, nullptr); }
+    bool addInput(const SharedSource* source) { return addInput(nullptr, source); }
+
+    void beginTick(uint32_t nowMs) {
+        _recorded = false;
+        writeHeader();
+        put(record::TAG_TICK);
+        putU32(nowMs);
+        for (uint8_t i = 0; i < _inputCount; ++i) {
+            uint32_t bits;
+            float v = _inputs[i].value ? *_inputs[i].value : _inputs[i].shared->read();
+            memcpy(&bits, &v, sizeof(bits));
+            putU32(bits);
+        }
+    }
+
+    bool notify(DisplayBase& display, const Notification& n) {
+        writeHeader();
+        put(record::TAG_NOTIFY);
+        put(uint8_t(n.type));
+        put(uint8_t(n.mode));
+        putPixel(n.color);
+        putU32(n.durationMs);
+        put(n.priority);
+        put(uint8_t(n.param));
+        put(uint8_t(n.param >> 8));
+        put(uint8_t(n.blend));
+        put(n.alpha);
+        putU32(n.maxWaitMs);
+        return display.notify(n);
+    }
+
+    void begin() override {
+        _output.begin();
+        memset(_previous, 0, size_t(_count) * sizeof(RGB));
+    }
+
+    RGB getPixel(int index) const override { return _output.getPixel(index); }
+    void setPixel(int index, const RGB& color) override { _output.setPixel(index, color); }
+    RGB* frameBuffer() override { return _output.frameBuffer(); }
+    int frameSize() const override { return _output.frameSize(); }
+    void writeSpan(int start, const RGB* colors, int count) override { _output.writeSpan(start, colors, count); }
+
+    void show() override {
+        recordFrame();
+        _recorded = false;
+        _output.show();
+    }
+
+    void showRange(int start, int count) override {
+        recordFrame();
+        _recorded = false;
+        _output.showRange(start, count);
+    }
+
+    const void* outputBus() const override { return _output.outputBus(); }
+
+    // In a DisplayGroup the bus may be shown through another display, so
+    // the frame is recorded here already.
+    void commit() override {
+        recordFrame();
+        _output.commit();
+    }
+
+    // Flushes buffered bytes; returns false if any write failed.
+    bool flush() {
+        if (_used > 0) {
+            _ok &= _sink.write(_buf, _used);
+            _used = 0;
+        }
+        return _ok;
+    }
+
+private:
+    struct Input {
+        const float* value;
+        const SharedSource* shared;
+    };
+
+    bool addInput(const float* value, const SharedSource* shared) {
+        if (_headerWritten || _inputCount >= record::MAX_INPUTS || (!value && !shared)) return false;
+        _inputs[_inputCount].value = value;
+        _inputs[_inputCount].shared = shared;
+        ++_inputCount;
+        return true;
+    }
+
+    void writeHeader() {
+        if (_headerWritten) return;
+        _headerWritten = true;
+        for (uint8_t i = 0; i < 4; ++i) put(record::MAGIC[i]);
+        put(record::VERSION);
+        put(uint8_t(_count));
+        put(uint8_t(_count >> 8));
+        put(_inputCount);
+    }
+
+    RGB current(int i) const {
+        const RGB* fb = _output.frameBuffer();
+        return fb ? fb[i] : _output.getPixel(i);
+    }
+
+    // Once per frame: show() after commit() records nothing new.
+    void recordFrame() {
+        if (_recorded) return;
+        _recorded = true;
+        writeHeader();
+        put(record::TAG_FRAME);
+        int i = 0;
+        while (i < _count) {
+            RGB c = current(i);
+            int j = i + 1;
+            if (record::samePixel(c, _previous[i])) {
+                while (j < _count && record::samePixel(current(j), _previous[j])) ++j;
+                putOp(record::OP_SKIP, uint32_t(j - i));
+                i = j;
+                continue;
+            }
+            while (j < _count && record::samePixel(current(j), c)) ++j;
+            if (j - i >= 3) {
+                putOp(record::OP_FILL, uint32_t(j - i));
+                putPixel(c);
+                for (int k = i; k < j; ++k) _previous[k] = c;
+                i = j;
+                continue;
+            }
+            // Literal run until an unchanged pixel or a run of three.
+            j = i + 1;
+            while (j < _count && !record::samePixel(current(j), _previous[j]) && !fillStarts(j)) ++j;
+            putOp(record::OP_COPY, uint32_t(j - i));
+            for (int k = i; k < j; ++k) {
+                _previous[k] = current(k);
+                putPixel(_previous[k]);
+            }
+            i = j;
+        }
+        put(record::OP_END);
+        flush();
+    }
+
+    bool fillStarts(int i) const {
+        if (i + 2 >= _count) return false;
+        RGB c = current(i);
+        return record::samePixel(current(i + 1), c) && record::samePixel(current(i + 2), c);
+    }
+
+    void put(uint8_t b) {
+        if (_used == sizeof(_buf)) flush();
+        _buf[_used++] = b;
+    }
+
+    void putU32(uint32_t v) {
+        for (uint8_t i = 0; i < 4; ++i) put(uint8_t(v >> (8 * i)));
+    }
+
+    void putOp(uint8_t op, uint32_t count) {
+        put(op);
+        while (count >= 0x80) {
+            put(uint8_t(count | 0x80));
+            count >>= 7;
+        }
+        put(uint8_t(count));
+    }
+
+    void putPixel(const RGB& c) {
+        put(c.r);
+        put(c.g);
+        put(c.b);
+    }
+
+    Renderer& _output;
+    RecordSink& _sink;
+    RGB* _previous;
+    int _count;
+    Input _inputs[record::MAX_INPUTS];
+    uint8_t _inputCount = 0;
+    bool _headerWritten = false;
+    bool _recorded = false;
+    bool _ok = true;
+    uint8_t _buf[64];
+    uint8_t _used = 0;
+};
+
+struct ReplayResult {
+    bool ok = false;             // stream was well formed to the end
+    uint32_t ticks = 0;
+    uint32_t frames = 0;         // frames in the recording
+    uint32_t mismatches = 0;     // ticks whose output differed
+    uint32_t firstMismatchMs = 0;
+};
+
+// Replays a recording through a Display as fast as it runs: before each
+// recorded tick the inputs are written to the targets registered with
+// addInput() (or to inputs[] passed to run()), which the display's layers
+// read, then the display ticks and its output is compared with the
+// recorded frame. Ticks a frame-rate target paced out are paced out again.
+// The governor's degradation level follows the measured frame cost, so a
+// governed display replays exactly only while it degrades as it did live.
+// `expected` is pixel-count storage for the recorded frame.
+class Replayer {
+public:
+    Replayer(RecordSource& source, RGB* expected, uint16_t count)
+        : _source(source), _expected(expected), _capacity(count) {}
+
+    // Reads the header; false if it is not a recording this build reads.
+    bool begin() {
+        uint8_t h[8];
+        if (!_source.read(h, sizeof(h)) || memcmp(h, record::MAGIC, 4) != 0 ||
+            h[4] != record::VERSION) {
+            return false;
+        }
+        _pixels = uint16_t(h[5] | (h[6] << 8));
+        _inputCount = h[7];
+        if (_pixels > _capacity || _inputCount > record::MAX_INPUTS) return false;
+        memset(_expected, 0, size_t(_pixels) * sizeof(RGB));
+        return true;
+    }
+
+    uint16_t pixelCount() const { return _pixels; }
+    uint8_t inputCount() const { return _inputCount; }
+
+    // Registers where each recorded input is written, in recording order.
+    // A SharedSource is only written when its value changes.
+    bool addInput(float* target) { return addTarget(target, nullptr); }
+    bool addInput(SharedSource* target) { return addTarget(nullptr, target); }
+
+    ReplayResult run(DisplayBase& display) { return run(display, nullptr); }
+
+    // Writes input i to inputs[i] unless a target was registered for it.
+    ReplayResult run(DisplayBase& display, float* inputs) {
+        ReplayResult result;
+        uint8_t tag;
+        bool haveTag = _source.read(&tag, 1);
+        while (haveTag) {
+            if (tag == record::TAG_NOTIFY) {
+                Notification n;
+                if (!readNotification(n)) return result;
+                display.notify(n);
+                haveTag = _source.read(&tag, 1);
+                continue;
+            }
+            if (tag != record::TAG_TICK) return result;
+            uint32_t nowMs;
+            if (!getU32(nowMs)) return result;
+            for (uint8_t i = 0; i < _inputCount; ++i) {
+                uint32_t bits;
+                if (!getU32(bits)) return result;
+                float v;
+                memcpy(&v, &bits, sizeof(v));
+                if (!writeInput(i, v, inputs, nowMs)) return result;
+            }
+            display.tick(nowMs);
+            ++result.ticks;
+
+            haveTag = _source.read(&tag, 1);
+            if (haveTag && tag == record::TAG_FRAME) {
+                if (!decodeFrame()) return result;
+                ++result.frames;
+                haveTag = _source.read(&tag, 1);
+            }
+            if (!matches(display.renderer())) {
+                if (result.mismatches == 0) result.firstMismatchMs = nowMs;
+                ++result.mismatches;
+            }
+        }
+        result.ok = true;
+        return result;
+    }
+
+private:
+    struct Target {
+        float* value;
+        SharedSource* shared;
+    };
+
+    bool addTarget(float* value, SharedSource* shared) {
+        if (_targetCount >= record::MAX_INPUTS || (!value && !shared)) return false;
+        _targets[_targetCount].value = value;
+        _targets[_targetCount].shared = shared;
+        ++_targetCount;
+        return true;
+    }
+
+    bool writeInput(uint8_t i, float v, float* inputs, uint32_t nowMs) {
+        if (i >= _targetCount) {
+            if (!inputs) return false;
+            inputs[i] = v;
+        } else if (_targets[i].value) {
+            *_targets[i].value = v;
+        } else {
+            float now = _targets[i].shared->read();
+            if (memcmp(&now, &v, sizeof(v)) != 0) _targets[i].shared->write(v, nowMs);
+        }
+        return true;
+    }
+
+    bool getU32(uint32_t& v) {
+        uint8_t b[4];
+        if (!_source.read(b, 4)) return false;
+        v = uint32_t(b[0]) | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+        return true;
+    }
+
+    bool readNotification(Notification& n) {
+        uint8_t head[5];
+        uint8_t tail[5];
+        if (!_source.read(head, 5) || !getU32(n.durationMs) || !_source.read(tail, 5) ||
+            !getU32(n.maxWaitMs)) {
+            return false;
+        }
+        n.type = NotifType(head[0]);
+        n.mode = NotifMode(head[1]);
+        n.color = RGB{head[2], head[3], head[4]};
+        n.priority = tail[0];
+        n.param = uint16_t(tail[1] | (tail[2] << 8));
+        n.blend = BlendOp(tail[3]);
+        n.alpha = tail[4];
+        return true;
+    }
+
+    bool decodeFrame() {
+        uint32_t pos = 0;
+        for (;;) {
+            uint8_t op;
+            if (!_source.read(&op, 1)) return false;
+            if (op == record::OP_END) return true;
+            uint32_t count = 0;
+            uint8_t shift = 0;
+            uint8_t b;
+            do {
+                if (!_source.read(&b, 1) || shift > 28) return false;
+                count |= uint32_t(b & 0x7F) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            if (pos + count > _pixels) return false;
+            if (op == record::OP_SKIP) {
+                pos += count;
+            } else if (op == record::OP_FILL) {
+                RGB c;
+                if (!_source.read(&c.r, 1) || !_source.read(&c.g, 1) || !_source.read(&c.b, 1)) return false;
+                for (uint32_t k = 0; k < count; ++k) _expected[pos++] = c;
+            } else if (op == record::OP_COPY) {
+                for (uint32_t k = 0; k < count; ++k, ++pos) {
+                    RGB& c = _expected[pos];
+                    if (!_source.read(&c.r, 1) || !_source.read(&c.g, 1) || !_source.read(&c.b, 1)) return false;
+                }
+            } else {
+                return false;
+            }
+        }
+    }
+
+    bool matches(Renderer& out) const {
+        const RGB* fb = out.frameBuffer();
+        for (uint16_t i = 0; i < _pixels; ++i) {
+            RGB c = fb ? fb[i] : out.getPixel(i);
+            if (!record::samePixel(c, _expected[i])) return false;
+        }
+        return true;
+    }
+
+    RecordSource& _source;
+    RGB* _expected;
+    uint16_t _capacity;
+    uint16_t _pixels = 0;
+    uint8_t _inputCount = 0;
+    Target _targets[record::MAX_INPUTS];
+    uint8_t _targetCount = 0;
+};
+
+#if !defined(ARDUINO)
+
+// stdio FILE adapters for recording and replaying on hosts.
+class FileSink : public RecordSink {
+public:
+    explicit FileSink(FILE* file) : _file(file) {}
+    bool write(const uint8_t* data, uint16_t len) override {
+        return _file && fwrite(data, 1, len, _file) == len;
+    }
+
+private:
+    FILE* _file;
+};
+
+class FileSource : public RecordSource {
+public:
+    explicit FileSource(FILE* file) : _file(file) {}
+    bool read(uint8_t* data, uint16_t len) override {
+        return _file && fread(data, 1, len, _file) == len;
+    }
+
+private:
+    FILE* _file;
+};
+
+#endif
+
+}
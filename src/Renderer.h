@@ -14,6 +14,41 @@ public:
     virtual RGB getPixel(int index) const = 0;
     virtual void setPixel(int index, const RGB& color) = 0;
     virtual void show() = 0;
+
+    // Shows a frame in which only [start, start + count) changed. Renderers
+    // that can transmit part of a frame (SPI strips, network sinks) override
+    // this; the default sends everything.
+    virtual void showRange(int start, int count) {
+        (void)start;
+        (void)count;
+        show();
+    }
+
+    // Contiguous pixel storage that Display composes into directly. Renderers
+    // that are not memory-backed return nullptr and receive the finished
+    // frame through writeSpan() instead. The pointer may change after
+    // show(), e.g. to the next slot of a ring, but the new storage must
+    // already hold the frame just shown: Display only recomposes what
+    // changed. Otherwise call Display::invalidate() after show().
+    virtual RGB* frameBuffer() { return nullptr; }
+    virtual int frameSize() const { return 0; }
+
+    // Identifies the driver behind show(). Renderers whose show() flushes
+    // the same shared output return the same key, so DisplayGroup calls
+    // show() once for all of them.
+    virtual const void* outputBus() const { return this; }
+
+    // Hands the composed frame to the output without showing it. Renderers
+    // that keep frames apart from their output (PipelinedRenderer) override
+    // this so that DisplayGroup can commit every display on a bus and then
+    // show the bus once.
+    virtual void commit() {}
+
+    virtual void writeSpan(int start, const RGB* colors, int count) {
+        for (int i = 0; i < count; ++i) {
+            setPixel(start + i, colors[i]);
+        }
+    }
 };
 
 }
@@ -0,0 +1,85 @@
+#include "Scalar.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define LEDLAYER_TABLE(type) const type PROGMEM
+#define LEDLAYER_READ_U32(p) pgm_read_dword(p)
+#else
+#define LEDLAYER_TABLE(type) const type
+#define LEDLAYER_READ_U32(p) (*(p))
+#endif
+
+namespace LedLayer {
+
+namespace {
+
+// log2(1 + i/32), 2^(i/32) and sin(i/32 * pi/2) in Q16.16.
+LEDLAYER_TABLE(uint32_t) kLog2Table[33] = {
+    0, 2909, 5732, 8473, 11136, 13727, 16248, 18704, 21098, 23433, 25711,
+    27936, 30109, 32234, 34312, 36346, 38336, 40286, 42196, 44068, 45904,
+    47705, 49472, 51207, 52911, 54584, 56229, 57845, 59434, 60997, 62534,
+    64047, 65536
+};
+
+LEDLAYER_TABLE(uint32_t) kExp2Table[33] = {
+    65536, 66971, 68438, 69936, 71468, 73032, 74632, 76266, 77936, 79642,
+    81386, 83169, 84990, 86851, 88752, 90696, 92682, 94711, 96785, 98905,
+    101070, 103283, 105545, 107856, 110218, 112631, 115098, 117618, 120194,
+    122825, 125515, 128263, 131072
+};
+
+LEDLAYER_TABLE(uint32_t) kQuarterSineTable[33] = {
+    0, 3216, 6424, 9616, 12785, 15924, 19024, 22078, 25080, 28020, 30893,
+    33692, 36410, 39040, 41576, 44011, 46341, 48559, 50660, 52639, 54491,
+    56212, 57798, 59244, 60547, 61705, 62714, 63572, 64277, 64827, 65220,
+    65457, 65536
+};
+
+// Linear interpolation in a 33-entry table; frac16 selects 0..1 across it.
+int32_t lerpTable(const uint32_t* table, uint32_t frac16) {
+    uint32_t idx = frac16 >> 11;
+    uint32_t rem = frac16 & 0x7FF;
+    int32_t a = int32_t(LEDLAYER_READ_U32(table + idx));
+    if (rem == 0) return a;
+    int32_t b = int32_t(LEDLAYER_READ_U32(table + idx + 1));
+    return a + int32_t(((b - a) * int32_t(rem)) >> 11);
+}
+
+}
+
+Fixed powUnit(Fixed x, Fixed g) {
+    int32_t raw = x.raw();
+    if (raw <= 0) return Fixed(0);
+    if (raw >= Fixed::ONE || g.raw() == 0) return Fixed(1);
+
+    // log2(x) = -shift + log2(m) with m normalized to [1, 2).
+    int32_t shift = 0;
+    uint32_t m = uint32_t(raw);
+    while (m < uint32_t(Fixed::ONE)) {
+        m <<= 1;
+        ++shift;
+    }
+    int32_t log2x = lerpTable(kLog2Table, m - Fixed::ONE) - shift * Fixed::ONE;
+
+    // 2^y with y <= 0, split into an integer shift and a fractional part.
+    int64_t y = (int64_t(log2x) * g.raw()) >> 16;
+    if (y <= -16 * int64_t(Fixed::ONE)) return Fixed(0);
+    int32_t whole = int32_t(y >> 16);
+    uint32_t frac = uint32_t(y - (int64_t(whole) << 16));
+    int32_t result = lerpTable(kExp2Table, frac);
+    return Fixed::fromRaw(whole >= 0 ? result << whole : result >> -whole);
+}
+
+#if LEDLAYER_FIXED_POINT
+Fixed pulseWave(uint32_t ms) {
+    // ms / 256 radians expressed in 1/65536 turns.
+    uint16_t phase = uint16_t((uint64_t(ms) * 2670177u) >> 16);
+    uint32_t quarter = (phase & 0x3FFF) << 2;
+    if (phase & 0x4000) quarter = 0x10000 - quarter;
+    int32_t s = lerpTable(kQuarterSineTable, quarter);
+    if (phase & 0x8000) s = -s;
+    return Fixed::fromRaw((Fixed::ONE + s) / 2);
+}
+#endif
+
+}
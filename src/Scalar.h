@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Numeric backend used by layers and tracks. Define LEDLAYER_FIXED_POINT=1
+// (e.g. in build flags) on FPU-less boards to run the whole pipeline on
+// Q16.16 integers instead of soft-float.
+#ifndef LEDLAYER_FIXED_POINT
+#define LEDLAYER_FIXED_POINT 0
+#endif
+
+namespace LedLayer {
+
+// Signed Q16.16 fixed-point number. Converts implicitly from float and int
+// literals so configuration code reads the same under both backends. The
+// range is -32768 to just under 32768; conversions saturate outside it
+// (and map NaN to 0), so feed large counts such as seconds in coarser
+// units.
+class Fixed {
+public:
+    static const int32_t ONE = 65536;
+
+    constexpr Fixed() : _raw(0) {}
+    constexpr Fixed(int v) : _raw(v > 32767 ? INT32_MAX : v < -32768 ? INT32_MIN : int32_t(v) * ONE) {}
+    constexpr Fixed(float v) : _raw(saturate(v * ONE + (v < 0 ? -0.5f : 0.5f))) {}
+    constexpr Fixed(double v) : _raw(saturate(v * ONE + (v < 0 ? -0.5 : 0.5))) {}
+
+    static constexpr Fixed fromRaw(int32_t raw) { return Fixed(raw, RawTag()); }
+    constexpr int32_t raw() const { return _raw; }
+    constexpr float toFloat() const { return _raw / float(ONE); }
+
+    Fixed& operator+=(Fixed o) { _raw += o._raw; return *this; }
+    Fixed& operator-=(Fixed o) { _raw -= o._raw; return *this; }
+    Fixed& operator*=(Fixed o) { _raw = int32_t((int64_t(_raw) * o._raw) >> 16); return *this; }
+    Fixed& operator/=(Fixed o) {
+        if (o._raw == 0) {
+            _raw = _raw < 0 ? INT32_MIN : INT32_MAX;
+        } else {
+            _raw = int32_t((int64_t(_raw) * ONE) / o._raw);
+        }
+        return *this;
+    }
+
+    friend Fixed operator-(Fixed a) { return fromRaw(-a._raw); }
+    friend Fixed operator+(Fixed a, Fixed b) { return a += b; }
+    friend Fixed operator-(Fixed a, Fixed b) { return a -= b; }
+    friend Fixed operator*(Fixed a, Fixed b) { return a *= b; }
+    friend Fixed operator/(Fixed a, Fixed b) { return a /= b; }
+    friend bool operator==(Fixed a, Fixed b) { return a._raw == b._raw; }
+    friend bool operator!=(Fixed a, Fixed b) { return a._raw != b._raw; }
+    friend bool operator<(Fixed a, Fixed b) { return a._raw < b._raw; }
+    friend bool operator<=(Fixed a, Fixed b) { return a._raw <= b._raw; }
+    friend bool operator>(Fixed a, Fixed b) { return a._raw > b._raw; }
+    friend bool operator>=(Fixed a, Fixed b) { return a._raw >= b._raw; }
+
+private:
+    struct RawTag {};
+    // Scaled values to raw ones, clamped to the int32_t range.
+    static constexpr int32_t saturate(float raw) {
+        return raw != raw ? 0 : raw >= 2147483648.0f ? INT32_MAX : raw <= -2147483648.0f ? INT32_MIN : int32_t(raw);
+    }
+    static constexpr int32_t saturate(double raw) {
+        return raw != raw ? 0 : raw >= 2147483647.0 ? INT32_MAX : raw <= -2147483648.0 ? INT32_MIN : int32_t(raw);
+    }
+
+    constexpr Fixed(int32_t raw, RawTag) : _raw(raw) {}
+
+    int32_t _raw;
+};
+
+#if LEDLAYER_FIXED_POINT
+typedef Fixed Scalar;
+#else
+typedef float Scalar;
+#endif
+
+// Backend-specific primitives. Display only uses these, so the per-frame
+// math compiles to either float or pure integer code.
+
+inline float toFloat(float v) { return v; }
+inline float toFloat(Fixed v) { return v.toFloat(); }
+
+inline float fracPart(float v) { return v - floorf(v); }
+inline Fixed fracPart(Fixed v) { return Fixed::fromRaw(v.raw() & (Fixed::ONE - 1)); }
+
+inline float absScalar(float v) { return fabsf(v); }
+inline Fixed absScalar(Fixed v) { return v.raw() < 0 ? -v : v; }
+
+// Truncates toward zero, like a float-to-int cast.
+inline int32_t toInt(float v) { return int32_t(v); }
+inline int32_t toInt(Fixed v) { return v.raw() < 0 ? -((-v.raw()) >> 16) : v.raw() >> 16; }
+
+// Rounds to the nearest integer, halves away from zero.
+inline int32_t roundInt(float v) { return toInt(v < 0.0f ? v - 0.5f : v + 0.5f); }
+inline int32_t roundInt(Fixed v) { return toInt(v.raw() < 0 ? v - Fixed(0.5f) : v + Fixed(0.5f)); }
+
+// Clamps v to 0..1 and scales it to a channel multiplier where 256 is 1.0.
+inline uint16_t toScale(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 256;
+    return uint16_t(v * 256.0f + 0.5f);
+}
+inline uint16_t toScale(Fixed v) {
+    if (v.raw() <= 0) return 0;
+    if (v.raw() >= Fixed::ONE) return 256;
+    return uint16_t((v.raw() + 128) >> 8);
+}
+
+// Clamps v at 0 and scales it to layout positions (65535 is 1.0). Values
+// past 1.0 stay representable so they can be used as exclusive bounds.
+inline uint32_t toPos(float v) {
+    if (v <= 0.0f) return 0;
+    return uint32_t(v * 65535.0f + 0.5f);
+}
+inline uint32_t toPos(Fixed v) {
+    if (v.raw() <= 0) return 0;
+    return uint32_t((int64_t(v.raw()) * 65535 + 32768) >> 16);
+}
+
+// Clamps v to 0..1 and maps it to a full-range byte.
+inline uint8_t toUnit8(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 255;
+    return uint8_t(v * 255.0f);
+}
+inline uint8_t toUnit8(Fixed v) {
+    if (v.raw() <= 0) return 0;
+    if (v.raw() >= Fixed::ONE) return 255;
+    return uint8_t((v.raw() * 255) >> 16);
+}
+
+// x^g for x in 0..1; the fixed-point version is table-driven.
+inline float powUnit(float x, float g) { return powf(x, g); }
+Fixed powUnit(Fixed x, Fixed g);
+
+// (sin(ms / 256) + 1) / 2, the breathing curve used by pulse effects.
+#if LEDLAYER_FIXED_POINT
+Fixed pulseWave(uint32_t ms);
+#else
+inline float pulseWave(uint32_t ms) { return (sinf(ms / 256.0f) + 1.0f) / 2.0f; }
+#endif
+
+// Multiplies a channel by a toScale() factor.
+inline uint8_t scaleChannel(uint8_t c, uint16_t scale) {
+    return uint8_t((uint16_t(c) * scale) >> 8);
+}
+
+}
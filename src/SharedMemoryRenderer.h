@@ -0,0 +1,222 @@
+#pragma once
+
+#if !defined(ARDUINO)
+
+#include <chrono>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Renderer.h"
+
+namespace LedLayer {
+
+// Layout of the memory-mapped frame ring shared by SharedMemoryRenderer
+// and SharedMemoryReader: a FrameRingHeader followed by slotCount slots of
+// slotStride bytes, each a FrameSlotHeader followed by pixelCount RGBs.
+struct FrameRingHeader {
+    static const uint32_t MAGIC = 0x524c4c46;  // "FLLR"
+    static const uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pixelCount;
+    uint32_t slotCount;
+    uint32_t slotStride;
+    uint32_t reserved;
+    uint64_t latest;  // sequence of the newest complete frame, 0 if none
+};
+
+struct FrameSlotHeader {
+    uint64_t sequence;  // 0 while the slot is being written
+    uint64_t timeNs;    // steady clock when the frame was published
+};
+
+inline size_t frameSlotStride(uint32_t pixelCount) {
+    size_t bytes = sizeof(FrameSlotHeader) + size_t(pixelCount) * sizeof(RGB);
+    return (bytes + 7) & ~size_t(7);
+}
+
+// Host renderer that publishes every shown frame into a ring of slots in
+// a memory-mapped file (e.g. under /dev/shm), so simulators and test
+// harnesses can read frames with zero copies while the render loop runs.
+// The Display composes straight into the next slot; show() stamps it with
+// the next sequence number and carries the frame over into the following
+// slot. Unchanged frames are therefore skipped as on any memory-backed
+// renderer, and changed ones only recompose their dirty range. Nothing is
+// allocated after construction. Readers must not fall more than
+// slotCount - 1 frames behind, or their slot is overwritten; the sequence
+// check in SharedMemoryReader detects this.
+class SharedMemoryRenderer : public Renderer {
+public:
+    SharedMemoryRenderer(const char* path, int numLeds, uint32_t slotCount = 8)
+        : _count(numLeds > 0 ? numLeds : 0), _slotCount(slotCount < 2 ? 2 : slotCount) {
+        _stride = frameSlotStride(uint32_t(_count));
+        _size = sizeof(FrameRingHeader) + _stride * _slotCount;
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return;
+        if (ftruncate(fd, off_t(_size)) == 0) {
+            void* map = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) _map = static_cast<uint8_t*>(map);
+        }
+        close(fd);
+        if (!_map) return;
+        FrameRingHeader* h = header();
+        h->pixelCount = uint32_t(_count);
+        h->slotCount = _slotCount;
+        h->slotStride = uint32_t(_stride);
+        h->version = FrameRingHeader::VERSION;
+        __atomic_store_n(&h->latest, uint64_t(0), __ATOMIC_RELAXED);
+        __atomic_store_n(&h->magic, FrameRingHeader::MAGIC, __ATOMIC_RELEASE);
+    }
+
+    ~SharedMemoryRenderer() {
+        if (_map) munmap(_map, _size);
+    }
+
+    SharedMemoryRenderer(const SharedMemoryRenderer&) = delete;
+    SharedMemoryRenderer& operator=(const SharedMemoryRenderer&) = delete;
+
+    bool ok() const { return _map != nullptr; }
+
+    void begin() override {}
+
+    RGB getPixel(int index) const override {
+        if (_map && index >= 0 && index < _count) return pixels(_slot)[index];
+        return {0, 0, 0};
+    }
+
+    void setPixel(int index, const RGB& color) override {
+        if (_map && index >= 0 && index < _count) pixels(_slot)[index] = color;
+    }
+
+    RGB* frameBuffer() override { return _map ? pixels(_slot) : nullptr; }
+    int frameSize() const override { return _map ? _count : 0; }
+
+    void show() override {
+        if (!_map) return;
+        FrameSlotHeader* cur = slot(_slot);
+        ++_sequence;
+        cur->timeNs = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+        __atomic_store_n(&cur->sequence, _sequence, __ATOMIC_RELEASE);
+        __atomic_store_n(&header()->latest, _sequence, __ATOMIC_RELEASE);
+
+        uint32_t next = _slot + 1 == _slotCount ? 0 : _slot + 1;
+        __atomic_store_n(&slot(next)->sequence, uint64_t(0), __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(pixels(next), pixels(_slot), size_t(_count) * sizeof(RGB));
+        _slot = next;
+    }
+
+    uint64_t sequence() const { return _sequence; }
+
+private:
+    FrameRingHeader* header() const { return reinterpret_cast<FrameRingHeader*>(_map); }
+
+    FrameSlotHeader* slot(uint32_t i) const {
+        return reinterpret_cast<FrameSlotHeader*>(_map + sizeof(FrameRingHeader) + _stride * i);
+    }
+
+    RGB* pixels(uint32_t i) const {
+        return reinterpret_cast<RGB*>(reinterpret_cast<uint8_t*>(slot(i)) + sizeof(FrameSlotHeader));
+    }
+
+    int _count;
+    uint32_t _slotCount;
+    size_t _stride = 0;
+    size_t _size = 0;
+    uint8_t* _map = nullptr;
+    uint32_t _slot = 0;
+    uint64_t _sequence = 0;
+};
+
+// Read side of a SharedMemoryRenderer ring, usable from another process.
+// frame() hands out a pointer into the mapping; check valid() after
+// reading it to make sure the writer did not reuse the slot meanwhile.
+class SharedMemoryReader {
+public:
+    explicit SharedMemoryReader(const char* path) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(FrameRingHeader)) {
+            void* map = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                _map = static_cast<const uint8_t*>(map);
+                _size = size_t(st.st_size);
+            }
+        }
+        close(fd);
+        if (!_map) return;
+        const FrameRingHeader* h = header();
+        if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != FrameRingHeader::MAGIC ||
+            h->version != FrameRingHeader::VERSION || h->slotCount == 0 ||
+            sizeof(FrameRingHeader) + size_t(h->slotStride) * h->slotCount > _size) {
+            munmap(const_cast<uint8_t*>(_map), _size);
+            _map = nullptr;
+        }
+    }
+
+    ~SharedMemoryReader() {
+        if (_map) munmap(const_cast<uint8_t*>(_map), _size);
+    }
+
+    SharedMemoryReader(const SharedMemoryReader&) = delete;
+    SharedMemoryReader& operator=(const SharedMemoryReader&) = delete;
+
+    bool ok() const { return _map != nullptr; }
+    int pixelCount() const { return _map ? int(header()->pixelCount) : 0; }
+
+    // Sequence of the newest complete frame, 0 if none was shown yet.
+    uint64_t latest() const {
+        return _map ? __atomic_load_n(&header()->latest, __ATOMIC_ACQUIRE) : 0;
+    }
+
+    // Pixels of frame seq, or nullptr if its slot already holds another one.
+    const RGB* frame(uint64_t seq, uint64_t* timeNs = nullptr) const {
+        if (!_map || seq == 0) return nullptr;
+        const FrameSlotHeader* s = slotFor(seq);
+        if (__atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE) != seq) return nullptr;
+        if (timeNs) *timeNs = s->timeNs;
+        return reinterpret_cast<const RGB*>(reinterpret_cast<const uint8_t*>(s) + sizeof(FrameSlotHeader));
+    }
+
+    // True if frame seq was still intact after the caller finished reading.
+    bool valid(uint64_t seq) const {
+        if (!_map || seq == 0) return false;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(&slotFor(seq)->sequence, __ATOMIC_RELAXED) == seq;
+    }
+
+    // Copies the newest frame into out (pixelCount() RGBs); returns its
+    // sequence, or 0 if no frame could be read.
+    uint64_t readLatest(RGB* out) const {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            uint64_t seq = latest();
+            const RGB* src = frame(seq);
+            if (!src) continue;
+            memcpy(out, src, size_t(pixelCount()) * sizeof(RGB));
+            if (valid(seq)) return seq;
+        }
+        return 0;
+    }
+
+private:
+    const FrameRingHeader* header() const { return reinterpret_cast<const FrameRingHeader*>(_map); }
+
+    const FrameSlotHeader* slotFor(uint64_t seq) const {
+        const FrameRingHeader* h = header();
+        uint32_t i = uint32_t((seq - 1) % h->slotCount);
+        return reinterpret_cast<const FrameSlotHeader*>(_map + sizeof(FrameRingHeader) + size_t(h->slotStride) * i);
+    }
+
+    const uint8_t* _map = nullptr;
+    size_t _size = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Renderer.h"
+
+// SIMD bodies for the span kernels in Blend.h. Each processes whole blocks
+// of 16 pixels and returns how many it handled; the caller finishes the
+// remainder with the scalar loop, which is also the only path on targets
+// without SSE2 or NEON. Define LEDLAYER_NO_SIMD to force the scalar path.
+#if !defined(LEDLAYER_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LEDLAYER_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LEDLAYER_SIMD_NEON 1
+#endif
+#endif
+
+namespace LedLayer {
+
+static_assert(sizeof(RGB) == 3, "span kernels treat RGB arrays as packed bytes");
+
+#if LEDLAYER_SIMD_SSE2
+
+// 16 pixels are 48 bytes, i.e. three vectors whose channel order repeats.
+inline void colorPattern(RGB c, __m128i out[3]) {
+    uint8_t bytes[48];
+    for (uint8_t i = 0; i < 48; i += 3) {
+        bytes[i] = c.r;
+        bytes[i + 1] = c.g;
+        bytes[i + 2] = c.b;
+    }
+    for (uint8_t k = 0; k < 3; ++k) {
+        out[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 16 * k));
+    }
+}
+
+// (v * m) >> 8 on the bytes of v, with 16-bit factors for the low and
+// high halves.
+inline __m128i scaleBytes(__m128i v, __m128i mLo, __m128i mHi) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), mLo), 8);
+    __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), mHi), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+
+inline uint16_t addSpanSimd(RGB* dst, uint16_t count, RGB color) {
+    __m128i pattern[3];
+    colorPattern(color, pattern);
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        for (uint8_t k = 0; k < 3; ++k) {
+            _mm_storeu_si128(p + k, _mm_adds_epu8(_mm_loadu_si128(p + k), pattern[k]));
+        }
+    }
+    return i;
+}
+
+inline uint16_t maxSpanSimd(RGB* dst, uint16_t count, RGB color) {
+    __m128i pattern[3];
+    colorPattern(color, pattern);
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        for (uint8_t k = 0; k < 3; ++k) {
+            _mm_storeu_si128(p + k, _mm_max_epu8(_mm_loadu_si128(p + k), pattern[k]));
+        }
+    }
+    return i;
+}
+
+inline uint16_t multiplySpanSimd(RGB* dst, uint16_t count, RGB color) {
+    uint16_t factors[48];
+    for (uint8_t i = 0; i < 48; i += 3) {
+        factors[i] = uint16_t(color.r) + 1;
+        factors[i + 1] = uint16_t(color.g) + 1;
+        factors[i + 2] = uint16_t(color.b) + 1;
+    }
+    __m128i m[6];
+    for (uint8_t k = 0; k < 6; ++k) {
+        m[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(factors + 8 * k));
+    }
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        for (uint8_t k = 0; k < 3; ++k) {
+            _mm_storeu_si128(p + k, scaleBytes(_mm_loadu_si128(p + k), m[2 * k], m[2 * k + 1]));
+        }
+    }
+    return i;
+}
+
+inline uint16_t scaleSpanSimd(RGB* dst, uint16_t count, uint16_t scale) {
+    const __m128i m = _mm_set1_epi16(int16_t(scale));
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        for (uint8_t k = 0; k < 3; ++k) {
+            _mm_storeu_si128(p + k, scaleBytes(_mm_loadu_si128(p + k), m, m));
+        }
+    }
+    return i;
+}
+
+#elif LEDLAYER_SIMD_NEON
+
+// vld3q/vst3q split 16 pixels into one vector per channel.
+
+inline uint8x16_t scaleBytes(uint8x16_t v, uint16_t m) {
+    uint16x8_t lo = vmulq_n_u16(vmovl_u8(vget_low_u8(v)), m);
+    uint16x8_t hi = vmulq_n_u16(vmovl_u8(vget_high_u8(v)), m);
+    return vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+}
+
+inline uint16_t addSpanSimd(RGB* dst, uint16_t count, RGB color) {
+    const uint8x16_t r = vdupq_n_u8(color.r);
+    const uint8x16_t g = vdupq_n_u8(color.g);
+    const uint8x16_t b = vdupq_n_u8(color.b);
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        uint8_t* p = reinterpret_cast<uint8_t*>(dst + i);
+        uint8x16x3_t px = vld3q_u8(p);
+        px.val[0] = vqaddq_u8(px.val[0], r);
+        px.val[1] = vqaddq_u8(px.val[1], g);
+        px.val[2] = vqaddq_u8(px.val[2], b);
+        vst3q_u8(p, px);
+    }
+    return i;
+}
+
+inline uint16_t maxSpanSimd(RGB* dst, uint16_t count, RGB color) {
+    const uint8x16_t r = vdupq_n_u8(color.r);
+    const uint8x16_t g = vdupq_n_u8(color.g);
+    const uint8x16_t b = vdupq_n_u8(color.b);
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        uint8_t* p = reinterpret_cast<uint8_t*>(dst + i);
+        uint8x16x3_t px = vld3q_u8(p);
+        px.val[0] = vmaxq_u8(px.val[0], r);
+        px.val[1] = vmaxq_u8(px.val[1], g);
+        px.val[2] = vmaxq_u8(px.val[2], b);
+        vst3q_u8(p, px);
+    }
+    return i;
+}
+
+inline uint16_t multiplySpanSimd(RGB* dst, uint16_t count, RGB color) {
+    const uint16_t r = uint16_t(color.r) + 1;
+    const uint16_t g = uint16_t(color.g) + 1;
+    const uint16_t b = uint16_t(color.b) + 1;
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        uint8_t* p = reinterpret_cast<uint8_t*>(dst + i);
+        uint8x16x3_t px = vld3q_u8(p);
+        px.val[0] = scaleBytes(px.val[0], r);
+        px.val[1] = scaleBytes(px.val[1], g);
+        px.val[2] = scaleBytes(px.val[2], b);
+        vst3q_u8(p, px);
+    }
+    return i;
+}
+
+inline uint16_t scaleSpanSimd(RGB* dst, uint16_t count, uint16_t scale) {
+    uint16_t i = 0;
+    for (; uint16_t(count - i) >= 16; i += 16) {
+        uint8_t* p = reinterpret_cast<uint8_t*>(dst + i);
+        for (uint8_t k = 0; k < 3; ++k) {
+            vst1q_u8(p + 16 * k, scaleBytes(vld1q_u8(p + 16 * k), scale));
+        }
+    }
+    return i;
+}
+
+#else
+
+inline uint16_t addSpanSimd(RGB*, uint16_t, RGB) { return 0; }
+inline uint16_t maxSpanSimd(RGB*, uint16_t, RGB) { return 0; }
+inline uint16_t multiplySpanSimd(RGB*, uint16_t, RGB) { return 0; }
+inline uint16_t scaleSpanSimd(RGB*, uint16_t, uint16_t) { return 0; }
+
+#endif
+
+}
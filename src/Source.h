@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace LedLayer {
+
+// A value written by one producer (an ISR or another core) and read by the
+// render loop without locks. It is a seqlock: the writer never waits, and a
+// reader that overlaps a write retries. On AVR the counter is a single byte
+// so it is read atomically.
+class SharedSource {
+public:
+#if defined(__AVR__)
+    typedef uint8_t Sequence;
+#else
+    typedef uint32_t Sequence;
+#endif
+
+    // Producer side. stampMs is stored with the value, e.g. the sample time.
+    void write(float value, uint32_t stampMs = 0) {
+        Sequence seq = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+        __atomic_store_n(&_seq, Sequence(seq + 1), __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(const_cast<float*>(&_value), &value, sizeof(value));
+        memcpy(const_cast<uint32_t*>(&_stampMs), &stampMs, sizeof(stampMs));
+        __atomic_store_n(&_seq, Sequence(seq + 2), __ATOMIC_RELEASE);
+    }
+
+    // Consumer side: a consistent value and its stamp.
+    void read(float& value, uint32_t& stampMs) const {
+        Sequence before;
+        Sequence after;
+        do {
+            before = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+            memcpy(&value, const_cast<const float*>(&_value), sizeof(value));
+            memcpy(&stampMs, const_cast<const uint32_t*>(&_stampMs), sizeof(stampMs));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+        } while ((before & 1) || before != after);
+    }
+
+    float read() const {
+        float value;
+        uint32_t stampMs;
+        read(value, stampMs);
+        return value;
+    }
+
+    // Advances by two on every write, so a reader can tell whether the value
+    // changed since it last looked. The 8-bit AVR counter repeats after 128
+    // writes, so a source written exactly that often between two ticks
+    // looks unchanged for one frame.
+    Sequence sequence() const { return __atomic_load_n(&_seq, __ATOMIC_ACQUIRE); }
+
+private:
+    volatile Sequence _seq = 0;
+    volatile float _value = 0.0f;
+    volatile uint32_t _stampMs = 0;
+};
+
+}
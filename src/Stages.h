@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Color.h"
+#include "Layer.h"
+#include "Mode.h"
+#include "Tracks.h"
+
+namespace LedLayer {
+
+// Applies one layer's filtered value to its track. val is the mapped and
+// smoothed value, discVal the same after hysteresis.
+typedef void (*LayerStage)(const CompactLayer& layer, Scalar val, Scalar discVal, FrameTracks& tracks);
+
+namespace stage {
+
+inline void setColor(FrameTracks& tracks, const CompactLayer& layer, RGB c, Scalar val) {
+    tracks.color.active = true;
+    tracks.color.color = c;
+    tracks.color.layer = &layer;
+    tracks.color.value = val;
+}
+
+inline void colorPalette(const CompactLayer& layer, Scalar val, Scalar discVal, FrameTracks& tracks) {
+    RGB c = {0, 0, 0};
+    uint8_t idx = uint8_t(roundInt(discVal));
+    uint8_t count = layer.paletteCount();
+    if (idx < count) {
+        c = layer.paletteColor(idx);
+    } else if (count > 0) {
+        c = layer.paletteColor(count - 1);
+    }
+    setColor(tracks, layer, c, val);
+}
+
+inline void colorGradient(const CompactLayer& layer, Scalar val, Scalar, FrameTracks& tracks) {
+    // Handled per-pixel from colorTrack.layer and colorTrack.value.
+    RGB c = {0, 0, 0};
+    setColor(tracks, layer, c, val);
+}
+
+inline void colorHue(const CompactLayer& layer, Scalar val, Scalar, FrameTracks& tracks) {
+    setColor(tracks, layer, hueToRgb(toUnit8(val)), val);
+}
+
+inline void colorBinary(const CompactLayer& layer, Scalar val, Scalar, FrameTracks& tracks) {
+    const LayerConfig::GradientParam& g = layer.params.gradient;
+    setColor(tracks, layer, val >= Scalar(0.5f) ? g.to : g.from, val);
+}
+
+inline void brightnessValue(const CompactLayer&, Scalar val, Scalar, FrameTracks& tracks) {
+    tracks.brightness.active = true;
+    tracks.brightness.scale *= val;
+}
+
+inline void brightnessBinary(const CompactLayer&, Scalar val, Scalar, FrameTracks& tracks) {
+    tracks.brightness.active = true;
+    tracks.brightness.scale *= val >= Scalar(0.5f) ? Scalar(1) : Scalar(0);
+}
+
+inline void brightnessGamma(const CompactLayer& layer, Scalar val, Scalar, FrameTracks& tracks) {
+    // Dims linearly; the curve is applied to the whole frame through the
+    // gamma table.
+    tracks.brightness.active = true;
+    tracks.brightness.scale *= val;
+    tracks.brightness.gamma = layer.params.brightness.gamma;
+}
+
+inline void brightnessLimiter(const CompactLayer&, Scalar val, Scalar, FrameTracks& tracks) {
+    if (val < tracks.brightness.limit) tracks.brightness.limit = val;
+    tracks.brightness.active = true;
+}
+
+template<FillMode FILL>
+void mask(const CompactLayer& layer, Scalar val, Scalar discVal, FrameTracks& tracks) {
+    Scalar amount = FILL == FillMode::TICKS ? discVal : val;
+    if (amount < Scalar(0)) amount = 0;
+    if (amount > Scalar(1)) amount = 1;
+    MaskTrack& m = tracks.mask;
+    m.active = true;
+    m.start = layer.params.mask.start;
+    m.amount = amount;
+    m.width = layer.params.mask.width;
+    m.ticks = layer.params.mask.ticks;
+    m.fillMode = FILL;
+}
+
+inline void motion(const CompactLayer& layer, Scalar val, Scalar, FrameTracks& tracks) {
+    MotionTrack& m = tracks.motion;
+    m.pattern = layer.mode;
+    m.segmentPixels = layer.params.motion.segmentPixels;
+    m.color = layer.params.motion.color;
+    m.speed = layer.params.motion.speed * (Scalar(0.2f) + val * Scalar(2));
+    m.density = layer.params.motion.density;
+    m.active = true;
+}
+
+// Combinable: scales the winning pattern's speed.
+inline void motionSpeed(const CompactLayer& layer, Scalar val, Scalar, FrameTracks& tracks) {
+    tracks.motion.speed *= layer.params.motion.speed * (Scalar(0.2f) + val * Scalar(2));
+}
+
+inline void overlay(const CompactLayer& layer, Scalar, Scalar, FrameTracks& tracks) {
+    const LayerConfig::OverlayParam& o = layer.params.overlay;
+    tracks.overlay.add(o.pos, o.color, o.thickness);
+}
+
+// val is the time over 12 hours. The hour hand is drawn thickness wide,
+// the minute hand in color and the second hand in accent, one pixel each.
+inline void clockHands(const CompactLayer& layer, Scalar val, Scalar, FrameTracks& tracks) {
+    const LayerConfig::OverlayParam& o = layer.params.overlay;
+    tracks.overlay.add(fracPart(o.pos + val), o.color, o.thickness);
+    tracks.overlay.add(fracPart(o.pos + fracPart(val * Scalar(12))), o.color, 1);
+    tracks.overlay.add(fracPart(o.pos + fracPart(val * Scalar(720))), o.accent, 1);
+}
+
+// Threshold marks and cardinal ticks do not depend on the value; Display
+// resolves them once per layout (see Display::cacheMarkers()).
+inline void staticOverlay(const CompactLayer&, Scalar, Scalar, FrameTracks&) {}
+
+}
+
+// Returns stage only if MODE is compiled in; otherwise the stage is never
+// referenced and not emitted.
+template<ModeSet MODES, ModeType MODE>
+LayerStage pick(LayerStage stage) {
+    return hasMode(MODES, MODE) ? stage : nullptr;
+}
+
+// The stage that implements mode, or nullptr if mode is not in MODES.
+// Chosen once when the pipeline is built.
+template<ModeSet MODES>
+LayerStage stageFor(ModeType mode) {
+    switch (mode) {
+        case ModeType::COLOR_STATE_PALETTE: return pick<MODES, ModeType::COLOR_STATE_PALETTE>(stage::colorPalette);
+        case ModeType::COLOR_CATEGORY_PALETTE: return pick<MODES, ModeType::COLOR_CATEGORY_PALETTE>(stage::colorPalette);
+        case ModeType::COLOR_BINARY: return pick<MODES, ModeType::COLOR_BINARY>(stage::colorBinary);
+        case ModeType::COLOR_VALUE_GRADIENT: return pick<MODES, ModeType::COLOR_VALUE_GRADIENT>(stage::colorGradient);
+        case ModeType::COLOR_VALUE_HUE: return pick<MODES, ModeType::COLOR_VALUE_HUE>(stage::colorHue);
+        case ModeType::BRIGHTNESS_VALUE: return pick<MODES, ModeType::BRIGHTNESS_VALUE>(stage::brightnessValue);
+        case ModeType::BRIGHTNESS_BINARY: return pick<MODES, ModeType::BRIGHTNESS_BINARY>(stage::brightnessBinary);
+        case ModeType::BRIGHTNESS_GAMMA: return pick<MODES, ModeType::BRIGHTNESS_GAMMA>(stage::brightnessGamma);
+        case ModeType::BRIGHTNESS_LIMITER: return pick<MODES, ModeType::BRIGHTNESS_LIMITER>(stage::brightnessLimiter);
+        case ModeType::MASK_FILL: return pick<MODES, ModeType::MASK_FILL>(stage::mask<FillMode::NORMAL>);
+        case ModeType::MASK_CENTER_FILL: return pick<MODES, ModeType::MASK_CENTER_FILL>(stage::mask<FillMode::CENTER>);
+        case ModeType::MASK_WINDOW_POSITION: return pick<MODES, ModeType::MASK_WINDOW_POSITION>(stage::mask<FillMode::WINDOW>);
+        case ModeType::MASK_TICK_COUNT: return pick<MODES, ModeType::MASK_TICK_COUNT>(stage::mask<FillMode::TICKS>);
+        case ModeType::MASK_SEGMENT_ENABLE: return pick<MODES, ModeType::MASK_SEGMENT_ENABLE>(stage::mask<FillMode::SEGMENT>);
+        case ModeType::MASK_DENSITY: return pick<MODES, ModeType::MASK_DENSITY>(stage::mask<FillMode::DENSITY>);
+        case ModeType::MOTION_SOLID: return pick<MODES, ModeType::MOTION_SOLID>(stage::motion);
+        case ModeType::MOTION_PULSE: return pick<MODES, ModeType::MOTION_PULSE>(stage::motion);
+        case ModeType::MOTION_BLINK: return pick<MODES, ModeType::MOTION_BLINK>(stage::motion);
+        case ModeType::MOTION_CHASE: return pick<MODES, ModeType::MOTION_CHASE>(stage::motion);
+        case ModeType::MOTION_SCANNER: return pick<MODES, ModeType::MOTION_SCANNER>(stage::motion);
+        case ModeType::MOTION_TWINKLE: return pick<MODES, ModeType::MOTION_TWINKLE>(stage::motion);
+        case ModeType::MOTION_SPEED: return pick<MODES, ModeType::MOTION_SPEED>(stage::motionSpeed);
+        case ModeType::OVERLAY_MARKER_SINGLE: return pick<MODES, ModeType::OVERLAY_MARKER_SINGLE>(stage::overlay);
+        case ModeType::OVERLAY_MARKER_THICK: return pick<MODES, ModeType::OVERLAY_MARKER_THICK>(stage::overlay);
+        case ModeType::OVERLAY_THRESHOLD_MARKS: return pick<MODES, ModeType::OVERLAY_THRESHOLD_MARKS>(stage::staticOverlay);
+        case ModeType::OVERLAY_CLOCK_HANDS: return pick<MODES, ModeType::OVERLAY_CLOCK_HANDS>(stage::clockHands);
+        case ModeType::OVERLAY_CARDINAL_TICKS: return pick<MODES, ModeType::OVERLAY_CARDINAL_TICKS>(stage::staticOverlay);
+        default: return nullptr;
+    }
+}
+
+}
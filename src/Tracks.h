@@ -2,6 +2,7 @@
 
 #include "Layer.h"
 #include "Mode.h"
+#include "Notification.h"
 #include "Renderer.h"
 
 namespace LedLayer {
@@ -17,46 +18,189 @@ enum class TrackType : uint8_t {
 struct ColorTrack {
     bool active = false;
     RGB color = {0, 0, 0};
-    const LayerConfig* layer = nullptr;
-    float value = 0.0f;
+    const CompactLayer* layer = nullptr;
+    Scalar value = 0.0f;
 };
 
 struct BrightnessTrack {
     bool active = false;
-    float scale = 1.0f;
-    float limit = 1.0f;
+    Scalar scale = 1.0f;
+    Scalar limit = 1.0f;
+    Scalar gamma = 1.0f;
 };
 
 enum class FillMode : uint8_t {
     NORMAL,
-    CENTER
+    CENTER,
+    WINDOW,
+    TICKS,
+    SEGMENT,
+    DENSITY
 };
 
 struct MaskTrack {
     bool active = false;
-    float start = 0.0f;
-    float amount = 1.0f;
+    Scalar start = 0.0f;
+    Scalar amount = 1.0f;
+    Scalar width = 0.1f;
+    uint8_t ticks = 0;
     FillMode fillMode = FillMode::NORMAL;
 };
 
+// The mask resolved to sorted, non-overlapping [begin, end) index runs.
+// Pixels between runs are unlit; inside runs only density/256 of the
+// pixels are lit, spread evenly.
+static const uint8_t MAX_MASK_RUNS = 16;
+struct MaskRuns {
+    struct Run {
+        uint16_t begin;
+        uint16_t end;
+    };
+    uint8_t count = 0;
+    uint16_t density = 256;
+    Run runs[MAX_MASK_RUNS];
+
+    void add(uint16_t begin, uint16_t end) {
+        if (begin >= end || count >= MAX_MASK_RUNS) return;
+        if (count > 0 && runs[count - 1].end >= begin) {
+            if (end > runs[count - 1].end) runs[count - 1].end = end;
+            return;
+        }
+        runs[count].begin = begin;
+        runs[count].end = end;
+        ++count;
+    }
+};
+
 struct MotionTrack {
     bool active = false;
     ModeType pattern = ModeType::MOTION_SOLID;
     uint8_t segmentPixels = 1;
+    uint8_t density = 0;
     RGB color = {255, 255, 255};
-    float speed = 1.0f;
+    Scalar speed = 1.0f;
 };
 
+// Default overlay marker capacity of a Display (its MAX_MARKERS).
 static const uint8_t MAX_OVERLAYS = 8;
 struct OverlayMarker {
-    float pos = 0.0f;
+    Scalar pos = 0.0f;
     RGB color = {255, 255, 255};
     uint8_t thickness = 1;
 };
 
+// Markers whose position changes per frame. The storage belongs to the
+// Display composing the frame; markers past capacity are dropped.
 struct OverlayTrack {
+    OverlayMarker* markers = nullptr;
+    uint8_t capacity = 0;
     uint8_t count = 0;
-    OverlayMarker markers[MAX_OVERLAYS];
+
+    void add(Scalar pos, RGB color, uint8_t thickness) {
+        if (count >= capacity) return;
+        OverlayMarker& marker = markers[count++];
+        marker.pos = pos;
+        marker.color = color;
+        marker.thickness = thickness;
+    }
+};
+
+// A marker resolved to an LED index, as cached for static marker sets.
+struct MarkerStamp {
+    uint16_t index;
+    RGB color;
+    uint8_t thickness;
+};
+
+// Bounding [begin, end) range of pixels that need recomposing.
+struct DirtyRange {
+    uint16_t begin = 0;
+    uint16_t end = 0;
+
+    bool empty() const { return begin >= end; }
+
+    void add(uint16_t b, uint16_t e) {
+        if (b >= e) return;
+        if (empty()) {
+            begin = b;
+            end = e;
+            return;
+        }
+        if (b < begin) begin = b;
+        if (e > end) end = e;
+    }
+
+    // Adds length pixels from head, wrapping past n on rings.
+    void addRun(uint16_t head, uint32_t length, uint16_t n, bool wraps) {
+        uint32_t runEnd = uint32_t(head) + length;
+        if (runEnd <= n) {
+            add(head, uint16_t(runEnd));
+        } else if (!wraps) {
+            add(head, n);
+        } else if (length >= n) {
+            add(0, n);
+        } else {
+            add(head, n);
+            add(0, uint16_t(runEnd - n));
+        }
+    }
+};
+
+// Everything the layer pass produces for one frame.
+struct FrameTracks {
+    ColorTrack color;
+    BrightnessTrack brightness;
+    MaskTrack mask;
+    MotionTrack motion;
+    OverlayTrack overlay;
+};
+
+// Time-dependent motion resolved once per frame. Lit pixels are multiplied
+// by scale (brightness with any pulse or blink folded in), and pixels in
+// [head, runEnd) or [0, wrapEnd) are drawn in color. With twinkle, lit
+// pixels first blend toward color by their twinkle level.
+struct MotionPlan {
+    uint16_t scale = 256;
+    RGB color = {0, 0, 0};
+    uint16_t head = 0;
+    uint16_t runEnd = 0;
+    uint16_t wrapEnd = 0;
+    bool twinkle = false;
+    uint8_t density = 0;    // sparkling LEDs per 256
+    uint32_t lifeMs = 0;    // how long one sparkle lasts
+    uint32_t slot = 0;      // without a twinkle buffer: sparkle set in use
+    uint8_t fade = 0;       // ... and its level, fading over the slot
+};
+
+// Stateless twinkle: whether LED index sparkles during slot.
+inline bool twinkleLit(uint16_t index, uint32_t slot, uint8_t density) {
+    uint32_t x = index * 0x9E3779B1u ^ slot * 0x85EBCA77u;
+    x ^= x >> 15;
+    x *= 0x2C1B3C6Du;
+    x ^= x >> 12;
+    return (x & 0xFF) < density;
+}
+
+// xorshift32: a full-period generator costing three shifts and xors.
+inline uint32_t xorshift32(uint32_t& state) {
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+// The active notification resolved for one frame: length pixels from head,
+// wrapping on rings.
+struct NotificationPlan {
+    bool draw = false;
+    NotifMode mode = NotifMode::OVERRIDE;
+    BlendOp blend = BlendOp::ADD;
+    uint8_t alpha = 255;
+    RGB color = {0, 0, 0};
+    uint16_t head = 0;
+    uint16_t length = 0;
 };
 
 }